@@ -3,10 +3,16 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <bench/data.h>
+#include <checkqueue.h>
 #include <coins.h>
 #include <policy/policy.h>
 #include <script/signingprovider.h>
+#include <streams.h>
 #include <test/util/transaction_utils.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
 
 #include <vector>
 
@@ -52,3 +58,50 @@ static void CCoinsCaching(benchmark::Bench& bench)
 }
 
 BENCHMARK(CCoinsCaching);
+
+// Access every input of a block through a coins cache that starts out empty on
+// top of the coins database, as ConnectBlock does after the cache was flushed.
+// With prefetch, the inputs are first loaded by PrefetchBlockInputs on worker
+// threads, as ConnectTip does when -par allows it.
+static void CCoinsCachingColdBlock(benchmark::Bench& bench, bool prefetch)
+{
+    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+
+    CCoinsViewDB db{"bench", /*nCacheSize*/ 8 << 20, /*fMemory*/ true, /*fWipe*/ false};
+    {
+        CCoinsViewCache setup(&db);
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                setup.AddCoin(txin.prevout, Coin(CTxOut(COIN, CScript() << OP_TRUE), 1, false), /*possible_overwrite*/ true);
+            }
+        }
+        setup.SetBestBlock(block.hashPrevBlock);
+        bool flushed = setup.Flush();
+        assert(flushed);
+    }
+
+    CCheckQueue<CCoinsPrefetchCheck> queue{128};
+    queue.StartWorkerThreads(std::max(GetNumCores() - 1, 0), "coinsfetch");
+
+    bench.unit("block").run([&] {
+        CCoinsViewCache cache(&db);
+        if (prefetch) PrefetchBlockInputs(block, cache, db, queue);
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                bool unspent = !cache.AccessCoin(txin.prevout).IsSpent();
+                assert(unspent);
+            }
+        }
+    });
+    queue.StopWorkerThreads();
+}
+
+static void CCoinsCachingColdBlockSerial(benchmark::Bench& bench) { CCoinsCachingColdBlock(bench, /*prefetch*/ false); }
+static void CCoinsCachingColdBlockPrefetch(benchmark::Bench& bench) { CCoinsCachingColdBlock(bench, /*prefetch*/ true); }
+
+BENCHMARK(CCoinsCachingColdBlockSerial);
+BENCHMARK(CCoinsCachingColdBlockPrefetch);
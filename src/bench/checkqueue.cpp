@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <checkqueue.h>
+#include <hash.h>
 #include <key.h>
 #include <prevector.h>
 #include <pubkey.h>
@@ -69,3 +70,59 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     ECC_Stop();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+
+// A check that does a little hashing, standing in for a signature check.
+struct HashJob {
+    uint256 data;
+    bool operator()()
+    {
+        for (int i = 0; i < 16; ++i) data = Hash(data);
+        return true;
+    }
+    void swap(HashJob& x) { std::swap(data, x.data); }
+};
+
+// Verifies one block of txs transactions with inputs checks each, using a
+// given number of threads (including the master), each transaction added
+// separately like ConnectBlock does. Shows how well the queue scales with -par.
+static void CCheckQueueScaling(benchmark::Bench& bench, int threads, size_t txs, size_t inputs)
+{
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE};
+    queue.StartWorkerThreads(threads - 1);
+    bench.batch(txs * inputs).unit("job").run([&] {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t tx = 0; tx < txs; ++tx) {
+            std::vector<HashJob> vChecks(inputs);
+            control.Add(vChecks);
+        }
+        assert(control.Wait());
+    });
+    queue.StopWorkerThreads();
+}
+
+// Many small transactions.
+static void CCheckQueueScaling1(benchmark::Bench& bench) { CCheckQueueScaling(bench, 1, 1000, 2); }
+static void CCheckQueueScaling2(benchmark::Bench& bench) { CCheckQueueScaling(bench, 2, 1000, 2); }
+static void CCheckQueueScaling4(benchmark::Bench& bench) { CCheckQueueScaling(bench, 4, 1000, 2); }
+static void CCheckQueueScaling8(benchmark::Bench& bench) { CCheckQueueScaling(bench, 8, 1000, 2); }
+static void CCheckQueueScaling16(benchmark::Bench& bench) { CCheckQueueScaling(bench, 16, 1000, 2); }
+static void CCheckQueueScaling32(benchmark::Bench& bench) { CCheckQueueScaling(bench, 32, 1000, 2); }
+static void CCheckQueueScaling64(benchmark::Bench& bench) { CCheckQueueScaling(bench, 64, 1000, 2); }
+
+// A few large transactions, such as consolidations with 1000 inputs each.
+static void CCheckQueueScalingLargeTxs1(benchmark::Bench& bench) { CCheckQueueScaling(bench, 1, 2, 1000); }
+static void CCheckQueueScalingLargeTxs4(benchmark::Bench& bench) { CCheckQueueScaling(bench, 4, 2, 1000); }
+static void CCheckQueueScalingLargeTxs16(benchmark::Bench& bench) { CCheckQueueScaling(bench, 16, 2, 1000); }
+static void CCheckQueueScalingLargeTxs64(benchmark::Bench& bench) { CCheckQueueScaling(bench, 64, 2, 1000); }
+
+BENCHMARK(CCheckQueueScaling1);
+BENCHMARK(CCheckQueueScaling2);
+BENCHMARK(CCheckQueueScaling4);
+BENCHMARK(CCheckQueueScaling8);
+BENCHMARK(CCheckQueueScaling16);
+BENCHMARK(CCheckQueueScaling32);
+BENCHMARK(CCheckQueueScaling64);
+BENCHMARK(CCheckQueueScalingLargeTxs1);
+BENCHMARK(CCheckQueueScalingLargeTxs4);
+BENCHMARK(CCheckQueueScalingLargeTxs16);
+BENCHMARK(CCheckQueueScalingLargeTxs64);
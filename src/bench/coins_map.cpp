@@ -0,0 +1,99 @@
+// Copyright (c) 2021-2022 The Bitcoin DX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <coins.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <streams.h>
+#include <version.h>
+
+#include <unordered_map>
+#include <vector>
+
+// Compare CCoinsMap against the std::unordered_map it replaced.
+using UnorderedCoinsMap = std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>;
+
+static constexpr size_t LOOKUP_MAP_SIZE{1000000};
+static constexpr size_t LOOKUPS{1000};
+
+// Perform the operations that connecting block 413567 performs on a fresh
+// coins cache: fetch every spent coin, spend it, and add every new output.
+// The map is constructed from map_args, e.g. to share a chunk pool.
+template <typename Map, typename... Args>
+static void CoinsMapConnectBlock(benchmark::Bench& bench, Args... map_args)
+{
+    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    const Coin coin{CTxOut{COIN, CScript() << OP_TRUE}, 1, false};
+
+    bench.unit("block").run([&] {
+        Map map{map_args...};
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& txin : tx->vin) {
+                    auto it = map.find(txin.prevout);
+                    if (it == map.end()) {
+                        it = map.emplace(std::piecewise_construct, std::forward_as_tuple(txin.prevout), std::forward_as_tuple(Coin{coin})).first;
+                    }
+                    if (it->second.flags & CCoinsCacheEntry::FRESH) {
+                        map.erase(it);
+                    } else {
+                        it->second.flags |= CCoinsCacheEntry::DIRTY;
+                        it->second.coin.Clear();
+                    }
+                }
+            }
+            for (uint32_t i = 0; i < tx->vout.size(); ++i) {
+                auto& entry = map[COutPoint(tx->GetHash(), i)];
+                entry.coin = Coin{coin};
+                entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+            }
+        }
+    });
+}
+
+// Look up random outpoints, half of which are present, in a large map.
+template <typename Map>
+static void CoinsMapLookup(benchmark::Bench& bench)
+{
+    FastRandomContext rng{true};
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(LOOKUP_MAP_SIZE);
+    Map map;
+    for (size_t i = 0; i < LOOKUP_MAP_SIZE; ++i) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoints.back()), std::forward_as_tuple());
+    }
+    std::vector<COutPoint> lookups;
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        lookups.push_back(i % 2 ? outpoints[rng.randrange(outpoints.size())] : COutPoint{rng.rand256(), 0});
+    }
+
+    size_t found{0};
+    bench.batch(LOOKUPS).unit("lookup").run([&] {
+        for (const COutPoint& outpoint : lookups) {
+            found += map.find(outpoint) != map.end();
+        }
+    });
+    assert(found > 0);
+}
+
+static void CoinsMapConnectBlockOpenHash(benchmark::Bench& bench) { CoinsMapConnectBlock<CCoinsMap>(bench); }
+static void CoinsMapConnectBlockOpenHashPooled(benchmark::Bench& bench)
+{
+    CCoinsMap::ChunkPool pool{1024};
+    CoinsMapConnectBlock<CCoinsMap>(bench, &pool);
+}
+static void CoinsMapConnectBlockUnordered(benchmark::Bench& bench) { CoinsMapConnectBlock<UnorderedCoinsMap>(bench); }
+static void CoinsMapLookupOpenHash(benchmark::Bench& bench) { CoinsMapLookup<CCoinsMap>(bench); }
+static void CoinsMapLookupUnordered(benchmark::Bench& bench) { CoinsMapLookup<UnorderedCoinsMap>(bench); }
+
+BENCHMARK(CoinsMapConnectBlockOpenHash);
+BENCHMARK(CoinsMapConnectBlockOpenHashPooled);
+BENCHMARK(CoinsMapConnectBlockUnordered);
+BENCHMARK(CoinsMapLookupOpenHash);
+BENCHMARK(CoinsMapLookupUnordered);
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <test/util/mining.h>
+#include <test/util/script.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <memory>
+#include <vector>
+
+// Connect a sequence of blocks that each add many coins, with a coins tip cache
+// small enough that FlushStateToDisk has to write it every few blocks, as during
+// IBD. Each epoch processes one block, which ProcessNewBlock does with cs_main
+// held nearly throughout, from ConnectTip to the FlushStateToDisk that follows
+// it. The maximum reported with -output_csv is the longest cs_main was held for
+// a block, which with a background flush no longer includes the coins write.
+static void ConnectBlockFlush(benchmark::Bench& bench, bool background)
+{
+    constexpr size_t NUM_BLOCKS{120};
+    constexpr size_t OUTPUTS_PER_BLOCK{10000};
+    constexpr CAmount OUTPUT_VALUE{1000};
+    constexpr size_t COINS_TIP_CACHE_BYTES{32 << 20};
+
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::REGTEST,
+        {background ? "-backgroundflush=1" : "-backgroundflush=0", "-maxmempool=5"});
+    const NodeContext& node = test_setup->m_node;
+    const CChainParams& params = Params();
+
+    // A bare OP_TRUE output can be spent with an empty scriptSig, so the blocks need
+    // no witness commitment and can be built before the ones they build on are connected.
+    const CScript op_true{CScript() << OP_TRUE};
+    CTxIn spendable{MineBlock(node, op_true)};
+    CAmount spendable_value{GetBlockSubsidy(1, params.GetConsensus())};
+    for (int i = 0; i < COINBASE_MATURITY; ++i) MineBlock(node, op_true);
+
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return node.chainman->ActiveChain().Tip())};
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    uint256 prev_hash{tip->GetBlockHash()};
+    for (size_t i = 0; i < NUM_BLOCKS; ++i) {
+        const int height{tip->nHeight + 1 + int(i)};
+        CMutableTransaction coinbase_tx;
+        coinbase_tx.vin.resize(1);
+        coinbase_tx.vin[0].scriptSig = CScript() << height << OP_0;
+        coinbase_tx.vout.emplace_back(GetBlockSubsidy(height, params.GetConsensus()), op_true);
+
+        CMutableTransaction tx;
+        tx.vin.push_back(spendable);
+        tx.vout.assign(OUTPUTS_PER_BLOCK, CTxOut{OUTPUT_VALUE, P2WSH_OP_TRUE});
+        spendable_value -= OUTPUTS_PER_BLOCK * OUTPUT_VALUE;
+        tx.vout.emplace_back(spendable_value, op_true);
+        spendable = CTxIn{tx.GetHash(), uint32_t(OUTPUTS_PER_BLOCK)};
+
+        auto block = std::make_shared<CBlock>();
+        block->vtx = {MakeTransactionRef(std::move(coinbase_tx)), MakeTransactionRef(std::move(tx))};
+        block->nVersion = VERSIONBITS_LAST_OLD_BLOCK_VERSION;
+        block->hashPrevBlock = prev_hash;
+        block->hashMerkleRoot = BlockMerkleRoot(*block);
+        block->nTime = tip->GetBlockTime() + 1 + i;
+        block->nBits = tip->nBits;
+        while (!CheckProofOfWork(block->GetHash(), block->nBits, params.GetConsensus())) ++block->nNonce;
+        prev_hash = block->GetHash();
+        blocks.push_back(std::move(block));
+    }
+
+    {
+        LOCK(::cs_main);
+        bool resized = node.chainman->ActiveChainstate().ResizeCoinsCaches(COINS_TIP_CACHE_BYTES, 8 << 20);
+        assert(resized);
+    }
+
+    auto next_block = blocks.begin();
+    bench.epochs(NUM_BLOCKS).epochIterations(1).unit("block").run([&] {
+        assert(next_block != blocks.end());
+        const std::shared_ptr<const CBlock>& block = *next_block++;
+        bool processed = node.chainman->ProcessNewBlock(params, block, /*fForceProcessing*/ true, /*fNewBlock*/ nullptr);
+        assert(processed);
+        assert(WITH_LOCK(::cs_main, return node.chainman->ActiveChain().Tip()->GetBlockHash()) == block->GetHash());
+    });
+}
+
+static void ConnectBlockFlushSync(benchmark::Bench& bench) { ConnectBlockFlush(bench, /*background*/ false); }
+static void ConnectBlockFlushBackground(benchmark::Bench& bench) { ConnectBlockFlush(bench, /*background*/ true); }
+
+BENCHMARK(ConnectBlockFlushSync);
+BENCHMARK(ConnectBlockFlushBackground);
@@ -4,6 +4,24 @@
 
 #include <bench/bench.h>
 #include <blockfilter.h>
+#include <random.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+//! Number of blocks built at once by the multi-block benchmarks
+static constexpr size_t FILTER_BUILD_BLOCKS{64};
+//! Number of outputs created and spent per block
+static constexpr size_t FILTER_BUILD_SCRIPTS_PER_BLOCK{2000};
+//! Number of consecutive filters scanned by the batch matching benchmarks
+static constexpr size_t FILTER_SCAN_BLOCKS{100000};
+//! Number of elements per filter scanned
+static constexpr size_t FILTER_SCAN_ELEMENTS_PER_BLOCK{100};
+//! Number of scripts of the wallet the filters are scanned for
+static constexpr size_t FILTER_SCAN_WALLET_SCRIPTS{100};
 
 static void ConstructGCSFilter(benchmark::Bench& bench)
 {
@@ -39,5 +57,125 @@ static void MatchGCSFilter(benchmark::Bench& bench)
     });
 }
 
+/** Blocks with their undo data, as read by the block filter index */
+static std::vector<std::pair<CBlock, CBlockUndo>> CreateFilterBlocks()
+{
+    FastRandomContext rng(/* fDeterministic */ true);
+    auto random_script = [&rng] {
+        const uint256 hash = rng.rand256();
+        return CScript() << OP_0 << std::vector<unsigned char>(hash.begin(), hash.end());
+    };
+
+    std::vector<std::pair<CBlock, CBlockUndo>> blocks(FILTER_BUILD_BLOCKS);
+    for (auto& [block, block_undo] : blocks) {
+        block.nNonce = rng.rand32();
+        for (size_t i = 0; i < FILTER_BUILD_SCRIPTS_PER_BLOCK / 2; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(2);
+            tx.vout.resize(2);
+            for (CTxOut& txout : tx.vout) txout.scriptPubKey = random_script();
+            block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+
+            CTxUndo& tx_undo = block_undo.vtxundo.emplace_back();
+            for (size_t j = 0; j < 2; ++j) {
+                tx_undo.vprevout.emplace_back(CTxOut(1000, random_script()), 1, false);
+            }
+        }
+    }
+    return blocks;
+}
+
+static void BuildBlockFilters(benchmark::Bench& bench, size_t num_threads)
+{
+    const auto blocks = CreateFilterBlocks();
+    std::vector<BlockFilter> filters(blocks.size());
+
+    bench.batch(blocks.size()).unit("block").run([&] {
+        // Hand out blocks one at a time, like the parallel index sync does
+        std::atomic<size_t> next{0};
+        auto build = [&] {
+            for (size_t i = next++; i < blocks.size(); i = next++) {
+                filters[i] = BlockFilter(BlockFilterType::BASIC, blocks[i].first, blocks[i].second);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_threads; ++i) {
+            threads.emplace_back(build);
+        }
+        build();
+        for (std::thread& t : threads) t.join();
+    });
+}
+
+static void BuildBlockFiltersSerial(benchmark::Bench& bench)
+{
+    BuildBlockFilters(bench, 1);
+}
+
+static void BuildBlockFiltersParallel(benchmark::Bench& bench)
+{
+    BuildBlockFilters(bench, std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8));
+}
+
+/** Basic filters of many blocks and the scripts of a wallet, a few of which are in them */
+static std::pair<std::vector<GCSFilter>, GCSFilter::ElementSet> CreateFilterScan()
+{
+    FastRandomContext rng(/* fDeterministic */ true);
+    auto random_element = [&rng] {
+        const uint256 hash = rng.rand256();
+        return GCSFilter::Element(hash.begin(), hash.begin() + 22);
+    };
+
+    GCSFilter::ElementSet wallet_scripts;
+    while (wallet_scripts.size() < FILTER_SCAN_WALLET_SCRIPTS) {
+        wallet_scripts.insert(random_element());
+    }
+    std::vector<GCSFilter> filters;
+    filters.reserve(FILTER_SCAN_BLOCKS);
+    for (size_t i = 0; i < FILTER_SCAN_BLOCKS; ++i) {
+        GCSFilter::ElementSet elements;
+        while (elements.size() < FILTER_SCAN_ELEMENTS_PER_BLOCK) {
+            elements.insert(random_element());
+        }
+        if (i % 1000 == 0) {
+            elements.insert(*wallet_scripts.begin());
+        }
+        const uint256 block_hash = rng.rand256();
+        filters.emplace_back(GCSFilter::Params(block_hash.GetUint64(0), block_hash.GetUint64(1), BASIC_FILTER_P, BASIC_FILTER_M), elements);
+    }
+    return {std::move(filters), std::move(wallet_scripts)};
+}
+
+static void MatchAnyGCSFilters(benchmark::Bench& bench)
+{
+    const auto [filters, wallet_scripts] = CreateFilterScan();
+
+    bench.epochs(3).epochIterations(1).batch(filters.size()).unit("block").run([&] {
+        size_t matches = 0;
+        for (const GCSFilter& filter : filters) {
+            matches += filter.MatchAny(wallet_scripts);
+        }
+        assert(matches >= FILTER_SCAN_BLOCKS / 1000);
+    });
+}
+
+static void MatchAnyBatchGCSFilters(benchmark::Bench& bench)
+{
+    const auto [filters, wallet_scripts] = CreateFilterScan();
+    std::vector<const GCSFilter*> filter_ptrs;
+    for (const GCSFilter& filter : filters) {
+        filter_ptrs.push_back(&filter);
+    }
+
+    bench.epochs(3).epochIterations(1).batch(filters.size()).unit("block").run([&] {
+        const std::vector<bool> matches = GCSFilter::MatchAnyBatch(filter_ptrs, wallet_scripts);
+        assert(static_cast<size_t>(std::count(matches.begin(), matches.end(), true)) >= FILTER_SCAN_BLOCKS / 1000);
+    });
+}
+
 BENCHMARK(ConstructGCSFilter);
 BENCHMARK(MatchGCSFilter);
+BENCHMARK(MatchAnyGCSFilters);
+BENCHMARK(MatchAnyBatchGCSFilters);
+BENCHMARK(BuildBlockFiltersSerial);
+BENCHMARK(BuildBlockFiltersParallel);
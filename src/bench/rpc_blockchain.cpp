@@ -6,6 +6,7 @@
 #include <bench/data.h>
 
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
@@ -58,3 +59,19 @@ static void BlockToJsonVerboseWrite(benchmark::Bench& bench)
 }
 
 BENCHMARK(BlockToJsonVerboseWrite);
+
+// Produces the same output as BlockToJsonVerbose followed by
+// BlockToJsonVerboseWrite, without building the complete UniValue tree.
+static void BlockToJsonVerboseStream(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    bench.run([&] {
+        size_t size = 0;
+        JSONStreamWriter writer{[&](std::string chunk) { size += chunk.size(); }};
+        blockToJSON(writer, data.block, &data.blockindex, &data.blockindex, /*verbose*/ true);
+        writer.Flush();
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+}
+
+BENCHMARK(BlockToJsonVerboseStream);
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <compat.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+#include <version.h>
+
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifndef WIN32
+static const int NUM_SYNCING_PEERS = 8;
+
+// Models serving the same historical block to several syncing peers over
+// loopback sockets, reporting the number of bytes put on the wire per second
+// of (single-threaded) CPU time. The block is either copied into a message of
+// its own for every peer, or queued for all of them as one shared payload.
+static void ServeBlock(benchmark::Bench& bench, bool shared)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>(CBaseChainParams::MAIN);
+    const std::vector<uint8_t>& block = benchmark::data::block413567;
+
+    CAddrMan addrman;
+    auto connman = std::make_unique<ConnmanTestMsg>(0x1337, 0x1337, addrman);
+    CConnman::Options options;
+    options.nSendBufferMaxSize = std::numeric_limits<unsigned int>::max();
+    options.m_peer_connect_timeout = std::numeric_limits<int32_t>::max();
+    connman->Init(options);
+
+    std::vector<CNode*> nodes;
+    std::vector<SOCKET> remote_sockets;
+    for (int i = 0; i < NUM_SYNCING_PEERS; ++i) {
+        int fds[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        CNode* node = new CNode{i, NODE_NETWORK, static_cast<SOCKET>(fds[0]), CAddress(), /* nKeyedNetGroupIn */ 0,
+                                /* nLocalHostNonceIn */ 0, CAddress(), /* pszDest */ "",
+                                ConnectionType::INBOUND, /* inbound_onion */ false};
+        connman->AddTestNode(*node);
+        nodes.push_back(node);
+        remote_sockets.push_back(fds[1]);
+    }
+
+    const auto payload = std::make_shared<const SharedNetPayload>(block);
+    const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+    const size_t wire_size = NUM_SYNCING_PEERS * (CMessageHeader::HEADER_SIZE + block.size());
+    std::vector<unsigned char> sink(1 << 18);
+
+    bench.unit("byte").batch(wire_size).run([&] {
+        for (CNode* node : nodes) {
+            if (shared) {
+                CSerializedNetMsg msg;
+                msg.m_type = NetMsgType::BLOCK;
+                msg.m_shared_payload = payload;
+                connman->PushMessage(node, std::move(msg));
+            } else {
+                connman->PushMessage(node, msg_maker.Make(NetMsgType::BLOCK, MakeSpan(block)));
+            }
+        }
+        size_t received = 0;
+        while (true) {
+            for (SOCKET socket : remote_sockets) {
+                ssize_t n;
+                while ((n = recv(socket, sink.data(), sink.size(), MSG_DONTWAIT)) > 0) {
+                    received += n;
+                }
+            }
+            if (received >= wire_size) break;
+            connman->SocketHandlerOnce();
+        }
+    });
+
+    connman->ClearTestNodes();
+    for (SOCKET socket : remote_sockets) {
+        CloseSocket(socket);
+    }
+}
+
+static void ServeBlockCopied(benchmark::Bench& bench) { ServeBlock(bench, /* shared */ false); }
+static void ServeBlockShared(benchmark::Bench& bench) { ServeBlock(bench, /* shared */ true); }
+
+BENCHMARK(ServeBlockCopied);
+BENCHMARK(ServeBlockShared);
+#endif // WIN32
@@ -0,0 +1,127 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <cuckoocache.h>
+#include <key.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <test/util/setup_common.h>
+#include <test/util/transaction_utils.h>
+#include <validation.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const size_t SIGCACHE_THREADS = 4;
+static const size_t SIGCACHE_OPS_PER_THREAD = 10000;
+
+// Models script check threads hitting the signature cache concurrently: each
+// looks up entries that are mostly present (as when connecting a block whose
+// transactions were in the mempool) and inserts one in ten it does not find.
+template <size_t SHARDS>
+static void SigCacheContention(benchmark::Bench& bench)
+{
+    using Cache = CuckooCache::sharded_cache<uint256, SignatureCacheHasher, SignatureCacheShardHasher, SHARDS>;
+    auto cache = std::make_unique<Cache>();
+    const uint32_t n_elems = cache->setup_bytes(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+
+    FastRandomContext rng(true);
+    std::vector<uint256> present(n_elems / 2);
+    for (uint256& entry : present) {
+        entry = rng.rand256();
+        cache->insert(entry);
+    }
+    std::vector<std::vector<uint256>> lookups(SIGCACHE_THREADS);
+    for (auto& thread_lookups : lookups) {
+        thread_lookups.reserve(SIGCACHE_OPS_PER_THREAD);
+        for (size_t i = 0; i < SIGCACHE_OPS_PER_THREAD; ++i) {
+            thread_lookups.push_back(rng.randrange(10) == 0 ? rng.rand256() : present[rng.randrange(present.size())]);
+        }
+    }
+
+    bench.batch(SIGCACHE_THREADS * SIGCACHE_OPS_PER_THREAD).unit("lookup").run([&] {
+        std::vector<std::thread> threads;
+        for (const auto& thread_lookups : lookups) {
+            threads.emplace_back([&cache, &thread_lookups] {
+                for (const uint256& entry : thread_lookups) {
+                    if (!cache->contains(entry, false)) cache->insert(entry);
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+    });
+}
+
+bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
+                       const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
+                       bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
+                       std::vector<CScriptCheck>* pvChecks) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+// Latency of checking the scripts of the first block after a restart, with
+// caches that are either empty or restored from what the node saved at shutdown
+// after accepting the block's transactions to its mempool. Each iteration is a
+// restart: a fresh salt, or the saved caches loaded again.
+static void ConnectBlockAfterRestart(benchmark::Bench& bench, bool persisted)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+
+    // A block's worth of Taproot key path spends
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTxOut> spent_outputs;
+    const CTransaction tx{BuildTaprootKeyPathSpend(key, 1000, spent_outputs)};
+    CCoinsView coins_dummy;
+    CCoinsViewCache coins(&coins_dummy);
+    for (size_t i = 0; i < tx.vin.size(); ++i) {
+        coins.AddCoin(tx.vin[i].prevout, Coin(spent_outputs[i], 1, false), false);
+    }
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+    const fs::path sigcache_path = gArgs.GetDataDirNet() / "sigcache.dat";
+    const fs::path scriptcache_path = gArgs.GetDataDirNet() / "scriptcache.dat";
+
+    LOCK(cs_main);
+    {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        assert(CheckInputScripts(tx, state, coins, flags, true, true, txdata, nullptr));
+        assert(DumpSignatureCache(sigcache_path));
+        assert(DumpScriptExecutionCache(scriptcache_path));
+    }
+    // Loading deletes the dumps, so move them aside and restore them before every run.
+    const fs::path sigcache_copy = gArgs.GetDataDirNet() / "sigcache.dat.copy";
+    const fs::path scriptcache_copy = gArgs.GetDataDirNet() / "scriptcache.dat.copy";
+    fs::rename(sigcache_path, sigcache_copy);
+    fs::rename(scriptcache_path, scriptcache_copy);
+
+    bench.unit("input").batch(tx.vin.size()).run([&] {
+        if (persisted) {
+            fs::copy_file(sigcache_copy, sigcache_path);
+            fs::copy_file(scriptcache_copy, scriptcache_path);
+            LoadSignatureCache(sigcache_path);
+            LoadScriptExecutionCache(scriptcache_path);
+        } else {
+            InitSignatureCache();
+            InitScriptExecutionCache();
+        }
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        bool ret = CheckInputScripts(tx, state, coins, flags, false, false, txdata, nullptr);
+        assert(ret);
+    });
+}
+
+static void ConnectBlockAfterRestartCold(benchmark::Bench& bench) { ConnectBlockAfterRestart(bench, false); }
+static void ConnectBlockAfterRestartPersisted(benchmark::Bench& bench) { ConnectBlockAfterRestart(bench, true); }
+
+static void SigCacheContentionOneShard(benchmark::Bench& bench) { SigCacheContention<1>(bench); }
+static void SigCacheContentionSharded(benchmark::Bench& bench) { SigCacheContention<SIGNATURE_CACHE_SHARDS>(bench); }
+
+BENCHMARK(SigCacheContentionOneShard);
+BENCHMARK(SigCacheContentionSharded);
+BENCHMARK(ConnectBlockAfterRestartCold);
+BENCHMARK(ConnectBlockAfterRestartPersisted);
@@ -0,0 +1,80 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+#include <version.h>
+
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifndef WIN32
+static const int NUM_IDLE_PEERS = 1000;
+
+// Models a node with many connected but idle peers: each iteration one peer
+// sends a ping over a loopback socket and the socket handler runs once. The
+// cost of an iteration is dominated by how the socket handler finds that one
+// ready socket among all the others.
+static void SocketHandlerIdlePeers(benchmark::Bench& bench, bool use_epoll)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    RaiseFileDescriptorLimit(2 * NUM_IDLE_PEERS + 100);
+
+    CAddrMan addrman;
+    auto connman = std::make_unique<ConnmanTestMsg>(0x1337, 0x1337, addrman);
+    CConnman::Options options;
+    options.nReceiveFloodSize = std::numeric_limits<unsigned int>::max();
+    options.m_peer_connect_timeout = std::numeric_limits<int32_t>::max();
+    options.m_use_epoll = use_epoll;
+    connman->Init(options);
+
+    std::vector<SOCKET> remote_sockets;
+    for (int i = 0; i < NUM_IDLE_PEERS; ++i) {
+        int fds[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        CNode* node = new CNode{i, NODE_NETWORK, static_cast<SOCKET>(fds[0]), CAddress(), /* nKeyedNetGroupIn */ 0,
+                                /* nLocalHostNonceIn */ 0, CAddress(), /* pszDest */ "",
+                                ConnectionType::INBOUND, /* inbound_onion */ false};
+        connman->AddTestNode(*node);
+        remote_sockets.push_back(fds[1]);
+    }
+
+    CSerializedNetMsg ping = CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, uint64_t{0});
+    std::vector<unsigned char> wire;
+    V1TransportSerializer{}.prepareForTransport(ping, wire);
+    wire.insert(wire.end(), ping.data.begin(), ping.data.end());
+
+    // Consume the initial writability events of the new sockets (the socket
+    // handler retrieves at most a few hundred per call) before measuring.
+    for (int i = 0; i < 5; ++i) {
+        connman->SocketHandlerOnce();
+    }
+
+    const SOCKET active = remote_sockets[NUM_IDLE_PEERS / 2];
+    bench.run([&] {
+        assert(send(active, wire.data(), wire.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(wire.size()));
+        connman->SocketHandlerOnce();
+    });
+    assert(connman->GetTotalBytesRecv() > 0);
+
+    connman->ClearTestNodes();
+    for (SOCKET socket : remote_sockets) {
+        CloseSocket(socket);
+    }
+}
+
+static void SocketHandlerIdlePeersPoll(benchmark::Bench& bench) { SocketHandlerIdlePeers(bench, /* use_epoll */ false); }
+static void SocketHandlerIdlePeersEpoll(benchmark::Bench& bench) { SocketHandlerIdlePeers(bench, /* use_epoll */ true); }
+
+BENCHMARK(SocketHandlerIdlePeersPoll);
+BENCHMARK(SocketHandlerIdlePeersEpoll);
+#endif // WIN32
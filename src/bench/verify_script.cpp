@@ -8,9 +8,11 @@
 #include <script/bitcoindxconsensus.h>
 #endif
 #include <script/script.h>
+#include <script/sigcache.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/transaction_utils.h>
+#include <validation.h>
 
 #include <array>
 
@@ -96,5 +98,54 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
     });
 }
 
+// Verification of the inputs of a transaction spending 100 Taproot outputs through
+// the key path, as the script check workers do for a block. The outputs are either all
+// paid to the same key, or each to a key of its own.
+static void VerifyTaprootInputs(benchmark::Bench& bench, bool batched, bool same_key)
+{
+    const ECCVerifyHandle verify_handle;
+    ECC_Start();
+    InitSignatureCache();
+
+    std::vector<CKey> keys(100);
+    keys[0].MakeNewKey(true);
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (same_key) {
+            keys[i] = keys[0];
+        } else {
+            keys[i].MakeNewKey(true);
+        }
+    }
+    std::vector<CTxOut> spent_outputs;
+    const CTransaction tx{BuildTaprootKeyPathSpend(keys, spent_outputs)};
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx, std::vector<CTxOut>(spent_outputs));
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+
+    bench.unit("input").batch(tx.vin.size()).run([&] {
+        std::vector<CScriptCheck> checks;
+        for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+            checks.emplace_back(spent_outputs[i], tx, i, flags, false, &txdata);
+        }
+        bool ret = true;
+        if (batched) {
+            ret = RunChecks(checks);
+        } else {
+            for (CScriptCheck& check : checks) ret &= check();
+        }
+        assert(ret);
+    });
+    ECC_Stop();
+}
+
+static void VerifyTaprootInputsSingle(benchmark::Bench& bench) { VerifyTaprootInputs(bench, false, true); }
+static void VerifyTaprootInputsBatch(benchmark::Bench& bench) { VerifyTaprootInputs(bench, true, true); }
+static void VerifyTaprootInputsDistinctKeysSingle(benchmark::Bench& bench) { VerifyTaprootInputs(bench, false, false); }
+static void VerifyTaprootInputsDistinctKeysBatch(benchmark::Bench& bench) { VerifyTaprootInputs(bench, true, false); }
+
 BENCHMARK(VerifyScriptBench);
 BENCHMARK(VerifyNestedIfScript);
+BENCHMARK(VerifyTaprootInputsSingle);
+BENCHMARK(VerifyTaprootInputsBatch);
+BENCHMARK(VerifyTaprootInputsDistinctKeysSingle);
+BENCHMARK(VerifyTaprootInputsDistinctKeysBatch);
@@ -9,10 +9,12 @@
 
 #include <chainparamsbase.h>
 #include <clientversion.h>
+#include <compat.h>
 #include <rpc/client.h>
 #include <rpc/mining.h>
 #include <rpc/protocol.h>
 #include <rpc/request.h>
+#include <sync.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -21,15 +23,18 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <stdio.h>
 #include <string>
+#include <thread>
 #include <tuple>
 
 #include <event2/buffer.h>
 #include <event2/keyvalq_struct.h>
+#include <event2/util.h>
 #include <support/events.h>
 
 #include <univalue.h>
@@ -77,6 +82,7 @@ static void SetupCliArgs(ArgsManager& argsman)
     argsman.AddArg("-rpcwaittimeout=<n>", strprintf("Timeout in seconds to wait for the RPC server to start, or 0 for no timeout. (default: %d)", DEFAULT_WAIT_CLIENT_TIMEOUT), ArgsManager::ALLOW_INT, OptionsCategory::OPTIONS);
     argsman.AddArg("-rpcwallet=<walletname>", "Send RPC for non-default wallet on RPC server (needs to exactly match corresponding -wallet option passed to bitcoindxd). This changes the RPC endpoint used, e.g. http://127.0.0.1:8332/wallet/<walletname>", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdin", "Read extra arguments from standard input, one per line until EOF/Ctrl-D (recommended for sensitive information such as passphrases). When combined with -stdinrpcpass, the first line from standard input is used for the RPC password.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-stdinpipeline", "Read commands from standard input, one per line until EOF/Ctrl-D, each a method followed by its arguments, separated by whitespace. Arguments may be quoted with single or double quotes. The commands are queued on a single keep-alive connection as soon as they are read, and their results are printed in order as they arrive. When combined with -stdinrpcpass, the first line from standard input is used for the RPC password.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdinrpcpass", "Read RPC password from standard input as a single line. When combined with -stdin, the first line from standard input is used for the RPC password. When combined with -stdinwalletpassphrase, -stdinrpcpass consumes the first line, and -stdinwalletpassphrase consumes the second.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdinwalletpassphrase", "Read wallet passphrase from standard input as a single line. When combined with -stdin, the first line from standard input is used for the wallet passphrase.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 }
@@ -667,22 +673,22 @@ public:
     }
 };
 
-static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+/** Host and port to connect to, from -rpcconnect, -rpcport and the chain */
+static void GetRPCHostPort(std::string& host, uint16_t& port)
 {
-    std::string host;
     // In preference order, we choose the following for the port:
     //     1. -rpcport
     //     2. port in -rpcconnect (ie following : in ipv4 or ]: in ipv6)
     //     3. default port for chain
-    uint16_t port{BaseParams().RPCPort()};
+    port = BaseParams().RPCPort();
     SplitHostPort(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT), port, host);
     port = static_cast<uint16_t>(gArgs.GetArg("-rpcport", port));
+}
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
-
+static raii_evhttp_connection OpenRPCConnection(struct event_base* base, const std::string& host, uint16_t port)
+{
     // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base, host, port);
 
     // Set connection timeout
     {
@@ -697,18 +703,14 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
             evhttp_connection_set_timeout(evcon.get(), 5 * YEAR_IN_SECONDS);
         }
     }
+    return evcon;
+}
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr)
-        throw std::runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
-
-    // Get credentials
+/** Credentials for the Authorization header; sets failedToGetAuthCookie if there are none */
+static std::string GetRPCCredentials(bool& failedToGetAuthCookie)
+{
     std::string strRPCUserColonPass;
-    bool failedToGetAuthCookie = false;
+    failedToGetAuthCookie = false;
     if (gArgs.GetArg("-rpcpassword", "") == "") {
         // Try fall back to cookie-based authentication if no password is provided
         if (!GetAuthCookie(&strRPCUserColonPass)) {
@@ -717,20 +719,11 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
     } else {
         strRPCUserColonPass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
     }
+    return strRPCUserColonPass;
+}
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Content-Type", "application/json");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    std::string strRequest = rh->PrepareRequest(strMethod, args).write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
+static std::string GetRPCEndpoint(const std::optional<std::string>& rpcwallet)
+{
     // check if we should use a special wallet endpoint
     std::string endpoint = "/";
     if (rpcwallet) {
@@ -742,14 +735,41 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
             throw CConnectionFailed("uri-encode failed");
         }
     }
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
+    return endpoint;
+}
+
+/** Send a JSON-RPC request over a connection; the reply is passed to `cb` */
+static void MakeRPCRequest(struct evhttp_connection* evcon, void (*cb)(struct evhttp_request*, void*), void* ctx, const std::string& host, const std::string& credentials, const std::string& endpoint, const std::string& strRequest, bool keep_alive)
+{
+    raii_evhttp_request req = obtain_evhttp_request(cb, ctx);
+    if (req == nullptr)
+        throw std::runtime_error("create http request failed");
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300
+    evhttp_request_set_error_cb(req.get(), http_error_cb);
+#endif
+
+    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+    assert(output_headers);
+    evhttp_add_header(output_headers, "Host", host.c_str());
+    evhttp_add_header(output_headers, "Connection", keep_alive ? "keep-alive" : "close");
+    evhttp_add_header(output_headers, "Content-Type", "application/json");
+    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(credentials)).c_str());
+
+    // Attach request data
+    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+    assert(output_buffer);
+    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+    int r = evhttp_make_request(evcon, req.get(), EVHTTP_REQ_POST, endpoint.c_str());
     req.release(); // ownership moved to evcon in above call
     if (r != 0) {
         throw CConnectionFailed("send http request failed");
     }
+}
 
-    event_base_dispatch(base.get());
-
+/** Check the HTTP status of a reply and parse its body */
+static UniValue ParseHTTPReply(BaseRequestHandler* rh, const HTTPReply& response, const std::string& host, uint16_t port, bool failedToGetAuthCookie)
+{
     if (response.status == 0) {
         std::string responseErrorMessage;
         if (response.error != -1) {
@@ -782,6 +802,30 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
     return reply;
 }
 
+static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+{
+    std::string host;
+    uint16_t port;
+    GetRPCHostPort(host, port);
+
+    // Obtain event base
+    raii_event_base base = obtain_event_base();
+
+    raii_evhttp_connection evcon = OpenRPCConnection(base.get(), host, port);
+
+    // Get credentials
+    bool failedToGetAuthCookie;
+    const std::string strRPCUserColonPass = GetRPCCredentials(failedToGetAuthCookie);
+
+    HTTPReply response;
+    const std::string strRequest = rh->PrepareRequest(strMethod, args).write() + "\n";
+    MakeRPCRequest(evcon.get(), http_request_done, &response, host, strRPCUserColonPass, GetRPCEndpoint(rpcwallet), strRequest, /* keep_alive */ false);
+
+    event_base_dispatch(base.get());
+
+    return ParseHTTPReply(rh, response, host, port, failedToGetAuthCookie);
+}
+
 /**
  * ConnectAndCallRPC wraps CallRPC with -rpcwait and an exception handler.
  *
@@ -901,6 +945,259 @@ static void SetGenerateToAddressArgs(const std::string& address, std::vector<std
     args.emplace(args.begin() + 1, address);
 }
 
+/**
+ * Split a command read by -stdinpipeline into its words. Words are separated
+ * by whitespace and may be quoted with single or double quotes. Outside single
+ * quotes, a backslash escapes the next character.
+ */
+static std::vector<std::string> SplitCommandLine(const std::string& line)
+{
+    std::vector<std::string> words;
+    std::string word;
+    bool in_word{false};
+    char quote{0};
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quote == '\'') {
+            if (c == '\'') quote = 0; else word += c;
+        } else if (c == '\\') {
+            if (++i == line.size()) throw std::runtime_error("backslash at end of line");
+            word += line[i];
+            in_word = true;
+        } else if (quote == '"') {
+            if (c == '"') quote = 0; else word += c;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_word = true;
+        } else if (IsSpace(c)) {
+            if (in_word) words.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (quote != 0) throw std::runtime_error("unterminated quote");
+    if (in_word) words.push_back(std::move(word));
+    return words;
+}
+
+/**
+ * Executes the commands read from standard input, one per line, over a single
+ * keep-alive connection (-stdinpipeline). Lines are read on a separate thread,
+ * so that every command is queued on the connection as soon as it is read,
+ * and the results are printed in order as soon as they arrive.
+ */
+class StdinPipeline
+{
+public:
+    int Run();
+
+private:
+    struct Call {
+        StdinPipeline* pipeline;
+        HTTPReply response;
+        bool done{false};
+        //! Why the command could not be sent, if it could not
+        std::optional<std::string> error;
+    };
+
+    /** Lines read from standard input. Shared with the reader thread, which may outlive the pipeline. */
+    struct Input {
+        Mutex mutex;
+        std::deque<std::string> lines GUARDED_BY(mutex);
+        bool eof GUARDED_BY(mutex){false};
+        bool closed GUARDED_BY(mutex){false};
+        //! Written to by the reader thread to wake up the event loop
+        evutil_socket_t notify_socket GUARDED_BY(mutex);
+
+        void Notify() EXCLUSIVE_LOCKS_REQUIRED(mutex)
+        {
+            if (!closed) send(notify_socket, "x", 1, 0);
+        }
+    };
+
+    static void ReadInput(std::shared_ptr<Input> input);
+    static void OnInput(evutil_socket_t fd, short, void* ctx);
+    static void OnReply(struct evhttp_request* req, void* ctx);
+
+    void Queue(const std::string& line);
+    /** Print the results of the calls at the front of the queue that have completed */
+    void PrintCompleted();
+    void Fail(const std::string& error);
+
+    DefaultRequestHandler m_handler;
+    std::string m_host;
+    uint16_t m_port;
+    std::string m_credentials;
+    bool m_failed_to_get_auth_cookie;
+    std::string m_endpoint;
+    raii_event_base m_base;
+    raii_evhttp_connection m_evcon;
+    std::shared_ptr<Input> m_input{std::make_shared<Input>()};
+    bool m_input_done{false};
+    std::deque<std::unique_ptr<Call>> m_calls;
+    std::optional<std::string> m_fatal_error;
+    int m_ret{0};
+};
+
+void StdinPipeline::ReadInput(std::shared_ptr<Input> input)
+{
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        LOCK(input->mutex);
+        if (input->closed) return;
+        input->lines.push_back(std::move(line));
+        // The event loop takes all lines at once, so it only needs waking up for the first
+        if (input->lines.size() == 1) input->Notify();
+    }
+    LOCK(input->mutex);
+    input->eof = true;
+    input->Notify();
+}
+
+void StdinPipeline::OnInput(evutil_socket_t fd, short, void* ctx)
+{
+    StdinPipeline& pipeline = *static_cast<StdinPipeline*>(ctx);
+    char buf[64];
+    while (recv(fd, buf, sizeof(buf), 0) > 0) {}
+    std::deque<std::string> lines;
+    {
+        LOCK(pipeline.m_input->mutex);
+        std::swap(lines, pipeline.m_input->lines);
+        pipeline.m_input_done = pipeline.m_input->eof;
+    }
+    try {
+        for (const std::string& line : lines) {
+            pipeline.Queue(line);
+        }
+        pipeline.PrintCompleted();
+    } catch (const std::exception& e) {
+        pipeline.Fail(e.what());
+    }
+}
+
+void StdinPipeline::OnReply(struct evhttp_request* req, void* ctx)
+{
+    Call& call = *static_cast<Call*>(ctx);
+    http_request_done(req, &call.response);
+    call.done = true;
+    try {
+        call.pipeline->PrintCompleted();
+    } catch (const std::exception& e) {
+        call.pipeline->Fail(e.what());
+    }
+}
+
+void StdinPipeline::Queue(const std::string& line)
+{
+    auto call = std::make_unique<Call>();
+    call->pipeline = this;
+    std::string request;
+    try {
+        std::vector<std::string> args = SplitCommandLine(line);
+        if (args.empty()) return;
+        const std::string method = args[0];
+        args.erase(args.begin());
+        request = m_handler.PrepareRequest(method, args).write() + "\n";
+    } catch (const std::exception& e) {
+        call->error = e.what();
+    }
+    if (!call->error) {
+        MakeRPCRequest(m_evcon.get(), OnReply, call.get(), m_host, m_credentials, m_endpoint, request, /* keep_alive */ true);
+    }
+    m_calls.push_back(std::move(call));
+}
+
+void StdinPipeline::PrintCompleted()
+{
+    while (!m_calls.empty() && (m_calls.front()->done || m_calls.front()->error)) {
+        const Call& call = *m_calls.front();
+        std::string strPrint;
+        int nRet = 0;
+        if (call.error) {
+            strPrint = "error: " + *call.error;
+            nRet = EXIT_FAILURE;
+        } else if (call.response.status == HTTP_UNAUTHORIZED) {
+            // Fails all the other calls as well
+            ParseHTTPReply(&m_handler, call.response, m_host, m_port, m_failed_to_get_auth_cookie);
+        } else {
+            try {
+                const UniValue reply = ParseHTTPReply(&m_handler, call.response, m_host, m_port, m_failed_to_get_auth_cookie);
+                const UniValue& error = find_value(reply, "error");
+                if (error.isNull()) {
+                    ParseResult(find_value(reply, "result"), strPrint);
+                } else {
+                    ParseError(error, strPrint, nRet);
+                }
+            } catch (const CConnectionFailed&) {
+                throw;
+            } catch (const std::exception& e) {
+                strPrint = std::string("error: ") + e.what();
+                nRet = EXIT_FAILURE;
+            }
+        }
+        if (strPrint != "") {
+            tfm::format(nRet == 0 ? std::cout : std::cerr, "%s\n", strPrint);
+        }
+        if (nRet != 0) m_ret = nRet;
+        m_calls.pop_front();
+    }
+    std::cout.flush();
+    if (m_input_done && m_calls.empty()) {
+        event_base_loopbreak(m_base.get());
+    }
+}
+
+void StdinPipeline::Fail(const std::string& error)
+{
+    m_fatal_error = error;
+    event_base_loopbreak(m_base.get());
+}
+
+int StdinPipeline::Run()
+{
+    GetRPCHostPort(m_host, m_port);
+    m_credentials = GetRPCCredentials(m_failed_to_get_auth_cookie);
+    std::optional<std::string> wallet_name{};
+    if (gArgs.IsArgSet("-rpcwallet")) wallet_name = gArgs.GetArg("-rpcwallet", "");
+    m_endpoint = GetRPCEndpoint(wallet_name);
+    m_base = obtain_event_base();
+    m_evcon = OpenRPCConnection(m_base.get(), m_host, m_port);
+
+    evutil_socket_t sockets[2];
+    if (evutil_socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        throw std::runtime_error("creating socket pair failed");
+    }
+    evutil_make_socket_nonblocking(sockets[0]);
+    WITH_LOCK(m_input->mutex, m_input->notify_socket = sockets[1]);
+    raii_event input_event = obtain_event(m_base.get(), sockets[0], EV_READ | EV_PERSIST, OnInput, this);
+    event_add(input_event.get(), nullptr);
+
+    std::thread reader(ReadInput, m_input);
+    event_base_dispatch(m_base.get());
+
+    {
+        LOCK(m_input->mutex);
+        m_input->closed = true;
+        evutil_closesocket(sockets[1]);
+    }
+    input_event.reset();
+    evutil_closesocket(sockets[0]);
+    if (m_input_done) {
+        reader.join();
+    } else {
+        // Still waiting for input that will not be used anymore
+        reader.detach();
+    }
+    // Free the connection and its requests before the calls they refer to
+    m_evcon.reset();
+
+    if (m_fatal_error) throw std::runtime_error(*m_fatal_error);
+    return m_ret;
+}
+
 static int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -927,6 +1224,13 @@ static int CommandLineRPC(int argc, char *argv[])
             gArgs.ForceSetArg("-rpcpassword", rpcPass);
         }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
+        if (gArgs.GetBoolArg("-stdinpipeline", false)) {
+            if (!args.empty() || gArgs.GetBoolArg("-stdin", false) || gArgs.GetBoolArg("-stdinwalletpassphrase", false) ||
+                gArgs.IsArgSet("-getinfo") || gArgs.GetBoolArg("-netinfo", false) || gArgs.GetBoolArg("-generate", false) || gArgs.GetBoolArg("-addrinfo", false)) {
+                throw std::runtime_error("-stdinpipeline reads the commands from standard input and cannot be combined with a command");
+            }
+            return StdinPipeline().Run();
+        }
         if (gArgs.GetBoolArg("-stdinwalletpassphrase", false)) {
             NO_STDIN_ECHO();
             std::string walletPass;
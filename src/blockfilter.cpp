@@ -7,6 +7,7 @@
 #include <set>
 
 #include <blockfilter.h>
+#include <crypto/common.h>
 #include <crypto/siphash.h>
 #include <hash.h>
 #include <primitives/transaction.h>
@@ -20,6 +21,10 @@ static constexpr int GCS_SER_TYPE = SER_NETWORK;
 /// Protocol version used to serialize parameters in GCS filter encoding.
 static constexpr int GCS_SER_VERSION = 0;
 
+/// Query sets up to this many times smaller than a filter are sorted and merged with it; larger
+/// ones are looked up in a table of the filter's elements, which saves sorting them.
+static constexpr uint64_t GCS_MERGE_MIN_FILTER_RATIO = 8;
+
 static const std::map<BlockFilterType, std::string> g_filter_types = {
     {BlockFilterType::BASIC, "basic"},
 };
@@ -92,11 +97,15 @@ GCSFilter::GCSFilter(const Params& params, std::vector<unsigned char> encoded_fi
 
     // Verify that the encoded filter contains exactly N elements. If it has too much or too little
     // data, a std::ios_base::failure exception will be raised.
-    BitStreamReader<VectorReader> bitreader(stream);
+    const Span<const unsigned char> data = MakeUCharSpan(m_encoded).subspan(m_encoded.size() - stream.size());
+    GolombRiceReader reader(data);
+    uint64_t delta;
     for (uint64_t i = 0; i < m_N; ++i) {
-        GolombRiceDecode(bitreader, m_params.m_P);
+        if (!reader.Decode(m_params.m_P, delta)) {
+            throw std::ios_base::failure("encoded_filter is too short");
+        }
     }
-    if (!stream.empty()) {
+    if ((reader.BitsRead() + 7) / 8 != data.size()) {
         throw std::ios_base::failure("encoded_filter contains excess data");
     }
 }
@@ -133,18 +142,16 @@ GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
 
 bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
 {
-    VectorReader stream(GCS_SER_TYPE, GCS_SER_VERSION, m_encoded, 0);
-
-    // Seek forward by size of N
-    uint64_t N = ReadCompactSize(stream);
-    assert(N == m_N);
-
-    BitStreamReader<VectorReader> bitreader(stream);
+    // Seek forward by size of N, which the constructor checked to be canonically encoded
+    GolombRiceReader reader(MakeUCharSpan(m_encoded).subspan(GetSizeOfCompactSize(m_N)));
 
     uint64_t value = 0;
     size_t hashes_index = 0;
     for (uint32_t i = 0; i < m_N; ++i) {
-        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        uint64_t delta;
+        if (!reader.Decode(m_params.m_P, delta)) {
+            throw std::ios_base::failure("encoded_filter is too short");
+        }
         value += delta;
 
         while (true) {
@@ -169,10 +176,96 @@ bool GCSFilter::Match(const Element& element) const
     return MatchInternal(&query, 1);
 }
 
+bool GCSFilter::MatchAnyInternal(const std::vector<const Element*>& elements, MatchScratch& scratch) const
+{
+    if (m_N == 0 || elements.empty()) {
+        return false;
+    }
+
+    std::vector<uint64_t>& queries = scratch.queries;
+    queries.clear();
+    for (const Element* element : elements) {
+        queries.push_back(HashToRange(*element));
+    }
+
+    if (queries.size() * GCS_MERGE_MIN_FILTER_RATIO <= m_N || m_F == 0) {
+        std::sort(queries.begin(), queries.end());
+        return MatchInternal(queries.data(), queries.size());
+    }
+
+    std::vector<uint64_t>& values = scratch.values;
+    values.clear();
+    GolombRiceReader reader(MakeUCharSpan(m_encoded).subspan(GetSizeOfCompactSize(m_N)));
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < m_N; ++i) {
+        uint64_t delta;
+        if (!reader.Decode(m_params.m_P, delta)) {
+            throw std::ios_base::failure("encoded_filter is too short");
+        }
+        if (value + delta < value) {
+            // Only a malformed filter wraps around, leave it to the merge
+            std::sort(queries.begin(), queries.end());
+            return MatchInternal(queries.data(), queries.size());
+        }
+        value += delta;
+        values.push_back(value);
+    }
+
+    // Index the values by their top bits. They are uniformly distributed in [0, F), so with
+    // between N and 2N buckets, a bucket holds about one value. Values of F and above, which
+    // no query can match, are left out.
+    const int shift = std::max(0, static_cast<int>(CountBits(m_F - 1)) - static_cast<int>(CountBits(m_N)));
+    const uint64_t num_buckets = ((m_F - 1) >> shift) + 1;
+    std::vector<uint32_t>& bucket_starts = scratch.bucket_starts;
+    bucket_starts.resize(num_buckets + 1);
+    uint32_t index = 0;
+    for (uint64_t bucket = 0; bucket < num_buckets; ++bucket) {
+        bucket_starts[bucket] = index;
+        while (index < values.size() && (values[index] >> shift) == bucket) {
+            ++index;
+        }
+    }
+    bucket_starts[num_buckets] = index;
+
+    for (const uint64_t query : queries) {
+        const uint64_t bucket = query >> shift;
+        for (uint32_t i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; ++i) {
+            if (values[i] == query) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/** The elements of a set as a list, which is faster to iterate over repeatedly */
+static std::vector<const GCSFilter::Element*> ListElements(const GCSFilter::ElementSet& elements)
+{
+    std::vector<const GCSFilter::Element*> list;
+    list.reserve(elements.size());
+    for (const GCSFilter::Element& element : elements) {
+        list.push_back(&element);
+    }
+    return list;
+}
+
 bool GCSFilter::MatchAny(const ElementSet& elements) const
 {
-    const std::vector<uint64_t> queries = BuildHashedSet(elements);
-    return MatchInternal(queries.data(), queries.size());
+    MatchScratch scratch;
+    return MatchAnyInternal(ListElements(elements), scratch);
+}
+
+std::vector<bool> GCSFilter::MatchAnyBatch(const std::vector<const GCSFilter*>& filters, const ElementSet& elements)
+{
+    // The element hashes depend on the key and size of each filter, so they cannot be shared
+    const std::vector<const Element*> element_list = ListElements(elements);
+    MatchScratch scratch;
+    std::vector<bool> results;
+    results.reserve(filters.size());
+    for (const GCSFilter* filter : filters) {
+        results.push_back(filter->MatchAnyInternal(element_list, scratch));
+    }
+    return results;
 }
 
 const std::string& BlockFilterTypeName(BlockFilterType filter_type)
@@ -53,6 +53,16 @@ private:
     /** Helper method used to implement Match and MatchAny */
     bool MatchInternal(const uint64_t* sorted_element_hashes, size_t size) const;
 
+    /** Buffers reused when matching one set of elements against many filters */
+    struct MatchScratch {
+        std::vector<uint64_t> queries;
+        std::vector<uint64_t> values;
+        std::vector<uint32_t> bucket_starts;
+    };
+
+    /** Helper method used to implement MatchAny and MatchAnyBatch */
+    bool MatchAnyInternal(const std::vector<const Element*>& elements, MatchScratch& scratch) const;
+
 public:
 
     /** Constructs an empty filter. */
@@ -80,6 +90,14 @@ public:
      * efficient that checking Match on multiple elements separately.
      */
     bool MatchAny(const ElementSet& elements) const;
+
+    /**
+     * Checks for each of the given filters if any of the given elements may be
+     * in it, as MatchAny does. This is faster than calling MatchAny on every
+     * filter, e.g. to scan the filters of many consecutive blocks for the
+     * scripts of a wallet.
+     */
+    static std::vector<bool> MatchAnyBatch(const std::vector<const GCSFilter*>& filters, const ElementSet& elements);
 };
 
 constexpr uint8_t BASIC_FILTER_P = 19;
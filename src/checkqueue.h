@@ -10,11 +10,30 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
 #include <vector>
 
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Run a chunk of verifications, stopping at the first failure. Check types that
+ * are faster to verify together can provide an overload for their own
+ * std::vector<T>, which is found through argument-dependent lookup. It must be
+ * declared wherever CCheckQueue<T> is used.
+ */
+template <typename T>
+bool RunChecks(std::vector<T>& checks)
+{
+    for (T& check : checks)
+        if (!check())
+            return false;
+    return true;
+}
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -24,12 +43,18 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Added verifications are split into chunks, sized so that every thread gets
+  * a few of them but no larger than nBatchSize, which are spread over
+  * per-worker deques, each with its own lock. A worker takes work
+  * from its own deque first, and steals from the other deques when that is
+  * empty, so workers don't contend on a single lock for every chunk.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Mutex to let idle threads sleep and be woken up
     Mutex m_mutex;
 
     //! Worker threads block on this when out of work
@@ -38,94 +63,100 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
-
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! A run of verifications, the unit of work taken by a worker.
+    using Chunk = std::vector<T>;
 
-    //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    struct WorkerDeque {
+        Mutex m_mutex;
+        std::deque<Chunk> chunks GUARDED_BY(m_mutex);
+        //! Emptied chunks, kept so Add can reuse their storage.
+        std::vector<Chunk> spare GUARDED_BY(m_mutex);
+    };
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes verifications that are no longer queued, but still
+     * being run by a worker.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<unsigned int> nTodo{0};
+
+    //! The evaluation result so far. Once it is false, the remaining checks are skipped.
+    std::atomic<bool> fAllOk{true};
+
+    //! One deque per worker thread. Only resized while there are no workers.
+    std::vector<std::unique_ptr<WorkerDeque>> m_deques;
 
-    //! The maximum number of elements to be processed in one batch
+    //! The deque to add the next chunk to.
+    size_t m_next_deque{0};
+
+    //! The number of chunks in all deques.
+    std::atomic<int> m_queued{0};
+
+    //! The number of worker threads that are idle, or about to be.
+    std::atomic<int> m_idle{0};
+
+    //! The maximum number of elements to be processed in one chunk
     const unsigned int nBatchSize;
 
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster)
+    /**
+     * Take a chunk from the front of one of the deques, trying the deque at start
+     * first. The emptied chunk passed in is left to that deque for reuse. Return
+     * whether a chunk was taken.
+     */
+    bool TakeChunk(size_t start, Chunk& chunk)
+    {
+        for (size_t i = 0; i < m_deques.size(); ++i) {
+            WorkerDeque& deque = *m_deques[(start + i) % m_deques.size()];
+            LOCK(deque.m_mutex);
+            if (deque.chunks.empty()) continue;
+            chunk.swap(deque.chunks.front());
+            if (deque.chunks.front().capacity() > 0) {
+                deque.spare.push_back(std::move(deque.chunks.front()));
+            }
+            deque.chunks.pop_front();
+            --m_queued;
+            return true;
+        }
+        return false;
+    }
+
+    //! Run the verifications in chunk, unless a check already failed, and account for them.
+    void RunChunk(Chunk& chunk)
+    {
+        if (fAllOk && !RunChecks(chunk)) fAllOk = false;
+        const unsigned int nNow = chunk.size();
+        // Destroy the checks before the master can return from Wait, as they may refer to data it
+        // releases then.
+        chunk.clear();
+        if (nTodo.fetch_sub(nNow) == nNow) {
+            // We processed the last element; inform the master, which may be waiting for it
+            LOCK(m_mutex);
+            m_master_cv.notify_one();
+        }
+    }
+
+    /** Internal function that does the verification work of a worker thread. */
+    void WorkerLoop(size_t index)
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                if (m_request_stop) {
-                    return false;
-                }
-
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the m_mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+        Chunk chunk;
+        while (true) {
+            if (TakeChunk(index, chunk)) {
+                RunChunk(chunk);
+                continue;
+            }
+            WAIT_LOCK(m_mutex, lock);
+            // Announcing ourselves as idle before checking for work again pairs with Add, which
+            // queues work before checking for idle workers, so a wake-up can't be missed.
+            ++m_idle;
+            while (m_queued == 0 && !m_request_stop) {
+                m_worker_cv.wait(lock); // wait
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+            --m_idle;
+            if (m_request_stop) return;
+        }
     }
 
 public:
@@ -134,24 +165,26 @@ public:
 
     //! Create a new check queue
     explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nBatchSize(nBatchSizeIn)
+        : nBatchSize(std::max(1U, nBatchSizeIn))
     {
+        m_deques.emplace_back(std::make_unique<WorkerDeque>());
     }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num)
+    //! Create a pool of new worker threads, named after thread_name.
+    void StartWorkerThreads(const int threads_num, const std::string& thread_name = "scriptch")
     {
-        {
-            LOCK(m_mutex);
-            nIdle = 0;
-            nTotal = 0;
-            fAllOk = true;
-        }
         assert(m_worker_threads.empty());
+        m_deques.clear();
+        for (int n = 0; n < std::max(1, threads_num); ++n) {
+            m_deques.emplace_back(std::make_unique<WorkerDeque>());
+        }
+        m_next_deque = 0;
+        m_queued = 0;
+        m_idle = 0;
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                WorkerLoop(n);
             });
         }
     }
@@ -159,22 +192,57 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true /* master thread */);
+        Chunk chunk;
+        // the master joins the workers until all checks are done
+        while (nTodo > 0) {
+            if (TakeChunk(0, chunk)) {
+                RunChunk(chunk);
+                continue;
+            }
+            WAIT_LOCK(m_mutex, lock);
+            while (nTodo > 0 && m_queued == 0 && !m_request_stop) {
+                m_master_cv.wait(lock); // wait
+            }
+            if (m_request_stop) return false;
+        }
+        // return the current status, and reset it for the next round
+        return fAllOk.exchange(true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        LOCK(m_mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty()) return;
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            m_worker_cv.notify_one();
-        else if (vChecks.size() > 1)
-            m_worker_cv.notify_all();
+        // Aim for a few chunks per thread, including the master, so large transactions are
+        // spread over all of them while small ones aren't split into more chunks than useful.
+        const size_t nChunksPerRound = 4 * (m_worker_threads.size() + 1);
+        const size_t nChunkSize = std::clamp<size_t>((vChecks.size() + nChunksPerRound - 1) / nChunksPerRound, 1, nBatchSize);
+        size_t nChunks = 0;
+        for (size_t pos = 0; pos < vChecks.size(); pos += nChunkSize) {
+            WorkerDeque& deque = *m_deques[m_next_deque];
+            m_next_deque = (m_next_deque + 1) % m_deques.size();
+            LOCK(deque.m_mutex);
+            Chunk chunk;
+            if (!deque.spare.empty()) {
+                chunk = std::move(deque.spare.back());
+                deque.spare.pop_back();
+            }
+            chunk.resize(std::min(nChunkSize, vChecks.size() - pos));
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                vChecks[pos + i].swap(chunk[i]);
+            }
+            deque.chunks.push_back(std::move(chunk));
+            ++m_queued;
+            ++nChunks;
+        }
+        if (m_idle > 0) {
+            LOCK(m_mutex);
+            if (nChunks == 1)
+                m_worker_cv.notify_one();
+            else
+                m_worker_cv.notify_all();
+        }
     }
 
     //! Stop all of the worker threads.
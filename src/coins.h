@@ -9,6 +9,7 @@
 #include <compressor.h>
 #include <core_memusage.h>
 #include <memusage.h>
+#include <openhashmap.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -18,7 +19,6 @@
 #include <stdint.h>
 
 #include <functional>
-#include <unordered_map>
 
 /**
  * A UTXO entry.
@@ -131,7 +131,7 @@ struct CCoinsCacheEntry
     CCoinsCacheEntry(Coin&& coin_, unsigned char flag) : coin(std::move(coin_)), flags(flag) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef OpenHashMap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -224,7 +224,13 @@ protected:
     mutable size_t cachedCoinsUsage;
 
 public:
-    CCoinsViewCache(CCoinsView *baseIn);
+    /**
+     * @param[in] chunk_pool  If set, the pool that the cache's map takes its
+     *                        node chunks from, and returns them to when the
+     *                        cache is flushed or destroyed. Must outlive the
+     *                        cache.
+     */
+    CCoinsViewCache(CCoinsView *baseIn, CCoinsMap::ChunkPool* chunk_pool = nullptr);
 
     /**
      * By deleting the copy constructor, we prevent accidentally using it when one intends to create a cache on top of a base cache.
@@ -275,6 +281,18 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Insert a coin that was read from the backing view ahead of time, as
+     * FetchCoin would have done on a cache miss. Has no effect if this cache
+     * already has an entry for the outpoint.
+     *
+     * @returns whether the coin was inserted.
+     *
+     * Used to warm the cache with lookups performed outside of it, see
+     * PrefetchBlockInputs().
+     */
+    bool EmplacePrefetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -305,10 +323,9 @@ public:
     bool HaveInputs(const CTransaction& tx) const;
 
     //! Force a reallocation of the cache map. This is required when downsizing
-    //! the cache because the map's allocator may be hanging onto a lot of
-    //! memory despite having called .clear().
-    //!
-    //! See: https://stackoverflow.com/questions/42114044/how-to-release-unordered-map-memory
+    //! the cache because the map keeps its bucket table, sized for the largest
+    //! number of entries it held, when .clear() is called. The new map uses the
+    //! same chunk pool.
     void ReallocateCache();
 
 private:
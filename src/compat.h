@@ -95,6 +95,8 @@ typedef char* sockopt_arg_type;
 // __APPLE__ poll is broke https://github.com/bitcoindx/bitcoindx/pull/14336#issuecomment-437384408
 #if defined(__linux__)
 #define USE_POLL
+// Linux additionally gets a persistent, edge-triggered epoll socket event loop
+#define USE_EPOLL
 #endif
 
 bool static inline IsSelectableSocket(const SOCKET& s) {
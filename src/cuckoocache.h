@@ -11,6 +11,8 @@
 #include <cmath>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <utility>
 #include <vector>
 
@@ -23,6 +25,10 @@
  *
  * 2. @ref cache is a cache which is performant in memory usage and lookup speed. It
  * is lockfree for erase operations. Elements are lazily erased on the next insert.
+ *
+ * 3. @ref sharded_cache splits a cache into independently locked shards, so that
+ * threads working on different shards don't contend, and counts hits, misses and
+ * evictions.
  */
 namespace CuckooCache
 {
@@ -120,6 +126,7 @@ public:
  *
  *  Read Operations:
  *      - contains() for `erase=false`
+ *      - for_each()
  *
  *  Read+Erase Operations:
  *      - contains() for `erase=true`
@@ -388,8 +395,9 @@ public:
      * @post one of the following: All previously inserted elements and e are
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
+     * @returns true if an element (e or a previously inserted one) was evicted
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
@@ -401,7 +409,7 @@ public:
             if (table[loc] == e) {
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return false;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
@@ -411,7 +419,7 @@ public:
                 table[loc] = std::move(e);
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return false;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -437,6 +445,7 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        return true;
     }
 
     /** contains iterates through the hash locations for a given element
@@ -477,6 +486,119 @@ public:
             }
         return false;
     }
+
+    /** for_each calls f on every element that is not marked as discardable,
+     * e.g. to save the cache contents.
+     *
+     * @param f a callable taking a const Element&
+     */
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (uint32_t i = 0; i < size; ++i)
+            if (!collection_flags.bit_is_set(i))
+                f(table[i]);
+    }
+};
+
+/** sharded_cache spreads elements over SHARDS independent caches, each guarded
+ * by its own lock. ShardHash maps an element to a number, of which the shard is
+ * the remainder modulo SHARDS; it should be independent of the bits Hash uses to
+ * place elements, so the elements of one shard still spread over its table.
+ *
+ * Lookups take the lock of their shard shared, inserts take it exclusively, so
+ * an insert only blocks the lookups of one shard. The counters are kept per
+ * shard as well, to avoid contention on them.
+ */
+template <typename Element, typename Hash, typename ShardHash, size_t SHARDS>
+class sharded_cache
+{
+    static_assert(SHARDS > 0, "a sharded_cache needs at least one shard");
+
+public:
+    struct stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        //! Elements dropped by inserts to make room, not counting erased ones.
+        uint64_t evictions{0};
+    };
+
+private:
+    struct alignas(64) shard {
+        mutable std::shared_mutex mutex;
+        cache<Element, Hash> elements;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+    };
+    std::array<shard, SHARDS> m_shards;
+    const ShardHash m_shard_hash{};
+
+    shard& shard_of(const Element& e) { return m_shards[m_shard_hash(e) % SHARDS]; }
+
+public:
+    sharded_cache() = default;
+
+    /** setup_bytes sizes every shard to an equal part of bytes.
+     *
+     * @returns the maximum number of elements storable, summed over the shards
+     */
+    uint32_t setup_bytes(size_t bytes)
+    {
+        uint32_t elements{0};
+        for (shard& s : m_shards) {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            elements += s.elements.setup_bytes(bytes / SHARDS);
+        }
+        return elements;
+    }
+
+    /** contains looks up e in its shard, see cache::contains. */
+    bool contains(const Element& e, const bool erase)
+    {
+        shard& s = shard_of(e);
+        bool found;
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            found = s.elements.contains(e, erase);
+        }
+        (found ? s.hits : s.misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
+    }
+
+    /** insert adds e to its shard, see cache::insert. */
+    void insert(Element e)
+    {
+        shard& s = shard_of(e);
+        bool evicted;
+        {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            evicted = s.elements.insert(std::move(e));
+        }
+        if (evicted) s.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** for_each visits the elements of every shard, see cache::for_each. */
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (const shard& s : m_shards) {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            s.elements.for_each(f);
+        }
+    }
+
+    /** get_stats sums the counters of all shards. */
+    stats get_stats() const
+    {
+        stats ret;
+        for (const shard& s : m_shards) {
+            ret.hits += s.hits.load(std::memory_order_relaxed);
+            ret.misses += s.misses.load(std::memory_order_relaxed);
+            ret.evictions += s.evictions.load(std::memory_order_relaxed);
+        }
+        return ret;
+    }
 };
 } // namespace CuckooCache
 
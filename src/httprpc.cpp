@@ -7,6 +7,7 @@
 #include <chainparams.h>
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <util/strencodings.h>
@@ -26,6 +27,8 @@
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
+/** Content type of binary RPC results */
+static const char* BINARY_CONTENT_TYPE = "application/octet-stream";
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
@@ -91,6 +94,78 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/**
+ * Reply to a single request the result of which the handler may write to a
+ * JSONStreamWriter. Small results are sent as a normal reply once complete,
+ * larger ones as a chunked reply while they are being produced.
+ */
+class StreamedReply
+{
+public:
+    StreamedReply(HTTPRequest* req, const UniValue& id)
+        : m_req(req), m_id(id), m_writer([this](std::string data) { WriteChunk(std::move(data)); }) {}
+
+    JSONStreamWriter& Writer() { return m_writer; }
+
+    /** Send the rest of the reply. Returns false if the result was not streamed. */
+    bool Finish()
+    {
+        if (!m_writer.HasOutput()) return false;
+        std::string rest = m_writer.TakeBuffer() + ",\"error\":null,\"id\":" + m_id.write() + "}\n";
+        if (m_chunked) {
+            m_req->WriteReplyChunk(rest);
+            m_req->EndChunkedReply();
+        } else {
+            m_req->WriteHeader("Content-Type", "application/json");
+            m_req->WriteReply(HTTP_OK, REPLY_PREFIX + rest);
+        }
+        return true;
+    }
+
+    /**
+     * End the reply after an error. Returns false if nothing was sent yet, in
+     * which case an error reply can still be sent instead.
+     */
+    bool Abort()
+    {
+        if (!m_chunked) return false;
+        if (m_closed) {
+            LogPrint(BCLog::RPC, "RPC client disconnected before the result was complete\n");
+        } else {
+            // There is no way to report the error once the status was sent, so
+            // leave the client with an incomplete JSON document
+            LogPrintf("RPC error after part of the result was sent, truncating the reply\n");
+        }
+        m_req->EndChunkedReply();
+        return true;
+    }
+
+private:
+    static constexpr const char* REPLY_PREFIX = "{\"result\":";
+
+    void WriteChunk(std::string data)
+    {
+        if (!m_chunked) {
+            m_req->WriteHeader("Content-Type", "application/json");
+            m_req->StartChunkedReply(HTTP_OK);
+            m_chunked = true;
+            m_closed = !m_req->WriteReplyChunk(REPLY_PREFIX);
+        }
+        // Stop producing the result once nobody reads it
+        if (m_closed || !m_req->WriteReplyChunk(data)) {
+            m_closed = true;
+            throw JSONStreamClosed();
+        }
+    }
+
+    HTTPRequest* const m_req;
+    const UniValue& m_id;
+    JSONStreamWriter m_writer;
+    bool m_chunked{false};
+    //! Whether the client went away
+    bool m_closed{false};
+};
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -144,6 +219,27 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/**
+ * Whether the client accepts results of RPCs that return serialized data
+ * (getblock, getblockheader, getrawtransaction) as raw bytes, by listing
+ * application/octet-stream in its Accept header. Other results, and errors,
+ * are always sent as JSON; clients tell them apart by the Content-Type.
+ */
+static bool AcceptsBinary(const HTTPRequest* req)
+{
+    const auto [found, accept] = req->GetHeader("accept");
+    if (!found) return false;
+    std::vector<std::string> media_ranges;
+    boost::split(media_ranges, accept, boost::is_any_of(","));
+    for (std::string& media_range : media_ranges) {
+        // Ignore parameters such as q=
+        media_range = media_range.substr(0, media_range.find(';'));
+        boost::trim(media_range);
+        if (boost::iequals(media_range, BINARY_CONTENT_TYPE)) return true;
+    }
+    return false;
+}
+
 static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
 {
     // JSONRPC handles only POST
@@ -175,6 +271,7 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         return false;
     }
 
+    StreamedReply streamed_reply{req, jreq.id};
     try {
         // Parse request
         UniValue valRequest;
@@ -199,7 +296,18 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            // Large results may be sent while they are being produced
+            jreq.result_stream = &streamed_reply.Writer();
+            // Serialized data may be sent as is if the client accepts it
+            std::vector<unsigned char> raw_result;
+            if (AcceptsBinary(req)) jreq.raw_result = &raw_result;
             UniValue result = tableRPC.execute(jreq);
+            if (streamed_reply.Finish()) return true;
+            if (!raw_result.empty()) {
+                req->WriteHeader("Content-Type", BINARY_CONTENT_TYPE);
+                req->WriteReply(HTTP_OK, std::string(raw_result.begin(), raw_result.end()));
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -230,9 +338,11 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
+        if (streamed_reply.Abort()) return false;
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        if (streamed_reply.Abort()) return false;
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
@@ -11,16 +11,20 @@
 #include <rpc/protocol.h> // For HTTP status codes
 #include <shutdown.h>
 #include <sync.h>
+#include <util/mpmcqueue.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/threadnames.h>
+#include <util/time.h>
 #include <util/translation.h>
 
-#include <deque>
+#include <atomic>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -35,6 +39,20 @@
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
+/** Maximum number of bytes of a chunked reply handed to libevent but not sent yet */
+static const size_t MAX_UNSENT_REPLY_BYTES = 4 << 20;
+
+/** Flow control of a chunked reply, shared by the worker producing it and the event thread sending it */
+struct ChunkedReplyState {
+    Mutex mutex;
+    std::condition_variable cond;
+    //! Bytes passed to WriteReplyChunk that were not written to the socket yet
+    size_t unsent GUARDED_BY(mutex){0};
+    //! Set once the connection was closed
+    bool closed GUARDED_BY(mutex){false};
+    //! Bytes handed to libevent since its output buffer was last empty; only used on the event thread
+    size_t handed{0};
+};
 
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
@@ -56,22 +74,37 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Work queue for distributing work over multiple threads.
+ * Work items are simply callable objects. They are passed to the workers
+ * through a bounded MPMCQueue, so producers and consumers don't serialize on
+ * a lock around the items themselves. Handing over is not lock-free, though:
+ * every item posts a semaphore, which takes its mutex and may wake a worker
+ * sleeping on its condition variable. A full queue rejects new items.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
-    Mutex cs;
-    std::condition_variable cond GUARDED_BY(cs);
-    std::deque<std::unique_ptr<WorkItem>> queue GUARDED_BY(cs);
-    bool running GUARDED_BY(cs);
-    const size_t maxDepth;
+    struct Task {
+        std::unique_ptr<WorkItem> item;
+        int64_t enqueue_time{0};
+    };
+    struct WorkerStats {
+        std::atomic<uint64_t> items{0};
+        std::atomic<int64_t> queue_wait{0};
+        std::atomic<int64_t> max_queue_wait{0};
+        std::atomic<int64_t> busy{0};
+    };
+
+    MPMCQueue<Task> queue;
+    /** Posted once per queued item, and once more to make the workers exit. Takes a mutex on every post and wait. */
+    CSemaphore available{0};
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> rejected{0};
+    std::vector<WorkerStats> worker_stats;
 
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth)
+    WorkQueue(size_t _maxDepth, int num_workers) : queue(_maxDepth), worker_stats(num_workers)
     {
     }
     /** Precondition: worker threads have all stopped (they have been joined).
@@ -79,40 +112,66 @@ public:
     ~WorkQueue()
     {
     }
-    /** Enqueue a work item */
+    /** Enqueue a work item. Ownership is only taken if this returns true. */
     bool Enqueue(WorkItem* item)
     {
-        LOCK(cs);
-        if (!running || queue.size() >= maxDepth) {
+        if (!running) {
+            return false;
+        }
+        Task task{std::unique_ptr<WorkItem>(item), GetTimeMicros()};
+        if (!queue.TryPush(std::move(task))) {
+            task.item.release();
+            ++rejected;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
+        available.post();
         return true;
     }
     /** Thread function */
-    void Run()
+    void Run(int worker_num)
     {
+        WorkerStats& stats = worker_stats.at(worker_num);
         while (true) {
-            std::unique_ptr<WorkItem> i;
-            {
-                WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
-                    cond.wait(lock);
-                if (!running && queue.empty())
-                    break;
-                i = std::move(queue.front());
-                queue.pop_front();
+            available.wait();
+            Task task;
+            // Every post is for an item that was pushed, but a push to an
+            // earlier position may still be in progress
+            while (!queue.TryPop(task)) {
+                if (!running) {
+                    // Pass on the wakeup to the next worker to exit
+                    available.post();
+                    return;
+                }
+                std::this_thread::yield();
             }
-            (*i)();
+            const int64_t start = GetTimeMicros();
+            const int64_t wait = start - task.enqueue_time;
+            (*task.item)();
+            task.item.reset();
+            ++stats.items;
+            stats.queue_wait += wait;
+            if (wait > stats.max_queue_wait) stats.max_queue_wait = wait;
+            stats.busy += GetTimeMicros() - start;
         }
     }
     /** Interrupt and exit loops */
     void Interrupt()
     {
-        LOCK(cs);
         running = false;
-        cond.notify_all();
+        available.post();
+    }
+
+    int NumWorkers() const { return worker_stats.size(); }
+
+    void GetStats(HTTPWorkQueueStats& stats) const
+    {
+        stats.depth = queue.Size();
+        stats.max_depth = queue.Capacity();
+        stats.rejected = rejected;
+        stats.workers.clear();
+        for (const WorkerStats& worker : worker_stats) {
+            stats.workers.push_back({worker.items, worker.queue_wait, worker.max_queue_wait, worker.busy});
+        }
     }
 };
 
@@ -332,7 +391,7 @@ static bool HTTPBindAddresses(struct evhttp* http)
 static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
 {
     util::ThreadRename(strprintf("httpworker.%i", worker_num));
-    queue->Run();
+    queue->Run(worker_num);
 }
 
 /** libevent event log callback */
@@ -391,8 +450,9 @@ bool InitHTTPServer()
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
 
-    g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
+    g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth, rpcThreads);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -419,7 +479,7 @@ static std::vector<std::thread> g_thread_http_workers;
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    const int rpcThreads = g_work_queue->NumWorkers();
     LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     g_thread_http = std::thread(ThreadHTTP, eventBase);
 
@@ -472,6 +532,13 @@ void StopHTTPServer()
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
+bool GetHTTPWorkQueueStats(HTTPWorkQueueStats& stats)
+{
+    if (!g_work_queue) return false;
+    g_work_queue->GetStats(stats);
+    return true;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -509,7 +576,9 @@ HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_re
 
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (chunkedReply && !replySent) {
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Unhandled request");
@@ -560,6 +629,21 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
+/** Re-enable reading from the socket once a reply was sent. This is the second
+ * part of the libevent workaround in http_request_cb. */
+static void ReenableReading(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
     assert(!replySent && req);
@@ -573,17 +657,105 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** Called by libevent once the output buffer of a connection with a chunked reply was written */
+static void chunked_reply_sent_cb(struct evhttp_connection*, void* arg)
+{
+    ChunkedReplyState& state = *static_cast<ChunkedReplyState*>(arg);
+    {
+        LOCK(state.mutex);
+        state.unsent -= state.handed;
+    }
+    state.handed = 0;
+    state.cond.notify_all();
+}
+
+/** Called by libevent when a connection with a chunked reply is closed */
+static void chunked_reply_closed_cb(struct evhttp_connection*, void* arg)
+{
+    ChunkedReplyState& state = *static_cast<ChunkedReplyState*>(arg);
+    WITH_LOCK(state.mutex, state.closed = true);
+    state.cond.notify_all();
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !chunkedReply && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    chunkedReply = std::make_shared<ChunkedReplyState>();
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state]{
+        evhttp_connection* evcon = evhttp_request_get_connection(req_copy);
+        if (evcon) {
+            evhttp_connection_set_closecb(evcon, chunked_reply_closed_cb, state.get());
+        } else {
+            WITH_LOCK(state->mutex, state->closed = true);
+            state->cond.notify_all();
+        }
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& chunk, std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+    assert(chunkedReply && req);
+    ChunkedReplyState& state = *chunkedReply;
+    {
+        WAIT_LOCK(state.mutex, lock);
+        const auto room = [&]() EXCLUSIVE_LOCKS_REQUIRED(state.mutex) { return state.closed || state.unsent < MAX_UNSENT_REPLY_BYTES; };
+        if (!deadline) {
+            state.cond.wait(lock, room);
+        } else if (!state.cond.wait_until(lock, *deadline, room)) {
+            return false;
         }
+        if (state.closed) return false;
+        state.unsent += chunk.size();
+    }
+    // The output buffer of the request belongs to the main thread now, so
+    // hand over each chunk in a buffer of its own
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto req_copy = req;
+    auto state_copy = chunkedReply;
+    const size_t size = chunk.size();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, state_copy, size]{
+        state_copy->handed += size;
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+        evhttp_send_reply_chunk_with_cb(req_copy, evb, chunked_reply_sent_cb, state_copy.get());
+#else
+        // No notification when the chunk was sent, so no flow control
+        evhttp_send_reply_chunk(req_copy, evb);
+        chunked_reply_sent_cb(nullptr, state_copy.get());
+#endif
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(chunkedReply && req);
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state]{
+        // The callbacks must not be called anymore once the state is gone
+        evhttp_connection* evcon = evhttp_request_get_connection(req_copy);
+        if (evcon) evhttp_connection_set_closecb(evcon, nullptr, nullptr);
+        // Frees the request right away if the connection is gone
+        evhttp_send_reply_end(req_copy);
+        if (evcon) ReenableReading(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
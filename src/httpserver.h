@@ -5,8 +5,14 @@
 #ifndef BITCOINDX_HTTPSERVER_H
 #define BITCOINDX_HTTPSERVER_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -16,6 +22,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct ChunkedReplyState;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -45,6 +52,23 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Statistics of the HTTP work queue and of the worker threads processing it */
+struct HTTPWorkQueueStats {
+    struct Worker {
+        uint64_t requests;
+        int64_t queue_wait; //!< Total time in microseconds requests spent queued
+        int64_t max_queue_wait;
+        int64_t busy; //!< Total time in microseconds spent handling requests
+    };
+    size_t depth{0};
+    size_t max_depth{0};
+    uint64_t rejected{0}; //!< Requests rejected because the queue was full
+    std::vector<Worker> workers;
+};
+
+/** Get statistics of the HTTP work queue. Returns false if the HTTP server is not initialized. */
+bool GetHTTPWorkQueueStats(HTTPWorkQueueStats& stats);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -58,6 +82,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! Set while a chunked reply is being sent
+    std::shared_ptr<ChunkedReplyState> chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -113,6 +139,32 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for a body that is sent as it is produced.
+     * nStatus is the HTTP status code to send.
+     *
+     * @note Call this instead of WriteReply, then WriteReplyChunk any number
+     * of times and finally EndChunkedReply.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next part of a chunked reply body. Blocks while more than
+     * MAX_UNSENT_REPLY_BYTES of earlier parts are waiting to be sent, so that
+     * a slow client limits how much of the body is held in memory. If a
+     * deadline is given, gives up waiting for the client once it has passed.
+     *
+     * @returns false if the client has gone away or the deadline passed, in
+     * which case the rest of the body need not be produced.
+     */
+    bool WriteReplyChunk(const std::string& chunk, std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+
+    /**
+     * Complete a chunked reply. As this will give the request back to the
+     * main thread, do not call any other HTTPRequest methods after calling this.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
@@ -13,11 +13,22 @@
 #include <validation.h> // For g_chainman
 #include <warnings.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
 constexpr uint8_t DB_BEST_BLOCK{'B'};
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
 
+//! Number of blocks the parallel sync takes from the active chain at once
+constexpr size_t PARALLEL_SYNC_ROUND_BLOCKS = 10000;
+//! Number of prepared blocks the parallel sync writes at once
+constexpr size_t PARALLEL_SYNC_BATCH_BLOCKS = 64;
+//! Number of blocks the parallel sync prepares ahead of the last one written, bounding its memory use
+constexpr size_t PARALLEL_SYNC_WINDOW = 4 * PARALLEL_SYNC_BATCH_BLOCKS;
+
 template <typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -127,6 +138,12 @@ void BaseIndex::ThreadSync()
     if (!m_synced) {
         auto& consensus_params = Params().GetConsensus();
 
+        // Catch up on several threads first, then finish the sync here and
+        // hand over to the ValidationInterface callbacks as usual
+        if (m_sync_threads > 0 && AllowParallelSync() && !ParallelSync(pindex)) {
+            return;
+        }
+
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
         while (true) {
@@ -192,6 +209,155 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::ParallelSync(const CBlockIndex*& pindex)
+{
+    struct State {
+        Mutex mutex;
+        std::condition_variable cond;
+        //! Blocks of the current round, in chain order
+        std::vector<const CBlockIndex*> blocks GUARDED_BY(mutex);
+        //! Prepared blocks of the current round that were not written yet
+        std::vector<std::unique_ptr<PreparedBlock>> prepared GUARDED_BY(mutex);
+        //! Positions in the round of the next block to prepare and to write
+        size_t next_prepare GUARDED_BY(mutex){0};
+        size_t next_write GUARDED_BY(mutex){0};
+        //! Set if a block could not be read or prepared
+        std::string error GUARDED_BY(mutex);
+        bool stop GUARDED_BY(mutex){false};
+    } state;
+
+    const auto& consensus_params = Params().GetConsensus();
+    auto prepare_blocks = [&] {
+        WAIT_LOCK(state.mutex, lock);
+        while (true) {
+            state.cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state.mutex) {
+                return state.stop || (state.next_prepare < state.blocks.size() &&
+                                      state.next_prepare < state.next_write + PARALLEL_SYNC_WINDOW);
+            });
+            if (state.stop) return;
+            const size_t pos = state.next_prepare++;
+            const CBlockIndex* block_index = state.blocks[pos];
+            std::unique_ptr<PreparedBlock> prepared;
+            std::string error;
+            {
+                REVERSE_LOCK(lock);
+                CBlock block;
+                if (!ReadBlockFromDisk(block, block_index, consensus_params)) {
+                    error = strprintf("Failed to read block %s from disk", block_index->GetBlockHash().ToString());
+                } else if (!(prepared = PrepareBlock(block, block_index))) {
+                    error = strprintf("Failed to prepare block %s for %s", block_index->GetBlockHash().ToString(), GetName());
+                }
+            }
+            if (prepared) {
+                prepared->pindex = block_index;
+                state.prepared[pos] = std::move(prepared);
+            } else if (state.error.empty()) {
+                state.error = error;
+            }
+            state.cond.notify_all();
+        }
+    };
+
+    int64_t last_log_time = 0;
+    int64_t last_locator_write_time = GetTime();
+    std::vector<std::unique_ptr<PreparedBlock>> batch;
+    auto write_batch = [&] {
+        if (batch.empty()) return true;
+        if (!WritePreparedBlocks(batch)) {
+            FatalError("%s: Failed to write blocks %d to %d to index database",
+                       __func__, batch.front()->pindex->nHeight, batch.back()->pindex->nHeight);
+            return false;
+        }
+        pindex = batch.back()->pindex;
+        m_best_block_index = pindex;
+        batch.clear();
+
+        int64_t current_time = GetTime();
+        if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
+            LogPrintf("Syncing %s with block chain from height %d on %d threads\n",
+                      GetName(), pindex->nHeight, m_sync_threads);
+            last_log_time = current_time;
+        }
+        // The locator only ever points to blocks that were written, so a crash
+        // at any time leaves an index that can continue from there
+        if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+            last_locator_write_time = current_time;
+            // No need to handle errors in Commit. See rationale in ThreadSync.
+            Commit();
+        }
+        return true;
+    };
+
+    auto sync = [&] {
+        while (!m_interrupt) {
+            std::vector<const CBlockIndex*> blocks;
+            {
+                LOCK(cs_main);
+                const CBlockIndex* pindex_next = NextSyncBlock(pindex, m_chainstate->m_chain);
+                if (!pindex_next) return true;
+                if (pindex_next->pprev != pindex) {
+                    if (!Rewind(pindex, pindex_next->pprev)) {
+                        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                   __func__, GetName());
+                        return false;
+                    }
+                    pindex = pindex_next->pprev;
+                }
+                while (pindex_next && blocks.size() < PARALLEL_SYNC_ROUND_BLOCKS) {
+                    blocks.push_back(pindex_next);
+                    pindex_next = m_chainstate->m_chain.Next(pindex_next);
+                }
+            }
+            {
+                LOCK(state.mutex);
+                state.prepared.clear();
+                state.prepared.resize(blocks.size());
+                state.blocks = std::move(blocks);
+                state.next_prepare = 0;
+                state.next_write = 0;
+            }
+            state.cond.notify_all();
+
+            while (true) {
+                std::unique_ptr<PreparedBlock> prepared;
+                {
+                    WAIT_LOCK(state.mutex, lock);
+                    if (state.next_write == state.blocks.size()) break;
+                    std::unique_ptr<PreparedBlock>& slot = state.prepared[state.next_write];
+                    while (!slot && state.error.empty() && !m_interrupt) {
+                        state.cond.wait_for(lock, std::chrono::milliseconds{100});
+                    }
+                    if (!state.error.empty()) {
+                        FatalError("%s: %s", __func__, state.error);
+                        return false;
+                    }
+                    // Keep what was prepared so far, the caller commits it
+                    if (m_interrupt) return write_batch();
+                    prepared = std::move(slot);
+                    ++state.next_write;
+                }
+                state.cond.notify_all();
+                batch.push_back(std::move(prepared));
+                if (batch.size() >= PARALLEL_SYNC_BATCH_BLOCKS && !write_batch()) return false;
+            }
+            if (!write_batch()) return false;
+        }
+        return true;
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < m_sync_threads; ++i) {
+        threads.emplace_back([&prepare_blocks, i] { util::TraceThread(strprintf("idxsync.%i", i).c_str(), prepare_blocks); });
+    }
+    const bool result = sync();
+    WITH_LOCK(state.mutex, state.stop = true);
+    state.cond.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return result;
+}
+
 bool BaseIndex::Commit()
 {
     CDBBatch batch(GetDB());
@@ -338,9 +504,10 @@ void BaseIndex::Interrupt()
     m_interrupt();
 }
 
-bool BaseIndex::Start(CChainState& active_chainstate)
+bool BaseIndex::Start(CChainState& active_chainstate, int sync_threads)
 {
     m_chainstate = &active_chainstate;
+    m_sync_threads = sync_threads;
     // Need to register this ValidationInterface before running Init(), so that
     // callbacks are not missed if Init sets m_synced to true.
     RegisterValidationInterface(this);
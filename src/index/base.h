@@ -11,9 +11,17 @@
 #include <threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <memory>
+#include <vector>
+
 class CBlockIndex;
 class CChainState;
 
+/** Default for -indexthreads, the number of threads preparing blocks while an index catches up (0 = off) */
+static constexpr int DEFAULT_INDEX_THREADS{0};
+/** Maximum number of threads preparing blocks while an index catches up */
+static constexpr int MAX_INDEX_THREADS{16};
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
@@ -60,6 +68,10 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Number of threads preparing blocks during the initial sync, see
+    /// ParallelSync. 0 if the blocks are processed on the sync thread only.
+    int m_sync_threads{0};
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
@@ -67,6 +79,13 @@ private:
     /// over and the sync thread exits.
     void ThreadSync();
 
+    /// Bring the index close to the active chain tip on m_sync_threads threads
+    /// that read blocks and call PrepareBlock, while the calling thread writes
+    /// the results in chain order with WritePreparedBlocks. Advances pindex to
+    /// the last block written. Returns false if the sync thread must exit
+    /// because of a fatal error.
+    bool ParallelSync(const CBlockIndex*& pindex);
+
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
     ///
     /// Recommendations for error handling:
@@ -91,6 +110,26 @@ protected:
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
+    /// Index entries of a block computed by PrepareBlock, to be written by
+    /// WritePreparedBlocks.
+    struct PreparedBlock {
+        const CBlockIndex* pindex{nullptr};
+        virtual ~PreparedBlock() = default;
+    };
+
+    /// Whether the index implements PrepareBlock and WritePreparedBlocks, so
+    /// that blocks can be prepared on several threads during the initial sync.
+    virtual bool AllowParallelSync() const { return false; }
+
+    /// Compute what WriteBlock would write for a block without depending on
+    /// the index state. Called for several blocks at once, on different
+    /// threads. Returns nullptr on failure.
+    virtual std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) { return nullptr; }
+
+    /// Write the prepared index entries of consecutive blocks of the active
+    /// chain, oldest first, the first of which follows the current best block.
+    virtual bool WritePreparedBlocks(const std::vector<std::unique_ptr<PreparedBlock>>& blocks) { return false; }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CommitInternal(CDBBatch& batch);
@@ -119,7 +158,9 @@ public:
 
     /// Start initializes the sync state and registers the instance as a
     /// ValidationInterface so that it stays in sync with blockchain updates.
-    [[nodiscard]] bool Start(CChainState& active_chainstate);
+    /// If sync_threads is positive and the index allows it, blocks are
+    /// prepared on that many threads while the index catches up.
+    [[nodiscard]] bool Start(CChainState& active_chainstate, int sync_threads = DEFAULT_INDEX_THREADS);
 
     /// Stops the instance from staying in sync with blockchain updates.
     void Stop();
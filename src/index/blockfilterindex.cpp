@@ -2,12 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <deque>
 #include <map>
 
 #include <dbwrapper.h>
 #include <index/blockfilterindex.h>
 #include <node/blockstorage.h>
 #include <util/system.h>
+#include <validation.h>
 
 /* The index database stores three items for each block: the disk location of the encoded filter,
  * its dSHA256 hash, and the header. Those belonging to blocks on the active chain are indexed by
@@ -37,6 +39,8 @@ constexpr unsigned int FLTR_FILE_CHUNK_SIZE = 0x100000; // 1 MiB
  *  is big enough for a 2,000,000 length block chain, which
  *  we should be enough until ~2047. */
 constexpr size_t CF_HEADERS_CACHE_MAX_SZ{2000};
+/** Approximate memory used by a filter cache entry besides the encoded filter */
+constexpr size_t FILTER_CACHE_ENTRY_OVERHEAD{sizeof(BlockFilter) + 96};
 
 namespace {
 
@@ -92,8 +96,12 @@ struct DBHashKey {
 static std::map<BlockFilterType, BlockFilterIndex> g_filter_indexes;
 
 BlockFilterIndex::BlockFilterIndex(BlockFilterType filter_type,
-                                   size_t n_cache_size, bool f_memory, bool f_wipe)
-    : m_filter_type(filter_type)
+                                   size_t n_cache_size, bool f_memory, bool f_wipe,
+                                   size_t filter_cache_size)
+    : m_filter_type(filter_type),
+      // Half of the cache size goes to the header chain, the other half to the filters
+      m_header_chain_max_entries(filter_cache_size / 2 / sizeof(CachedHeader)),
+      m_filter_cache_max_bytes(filter_cache_size - filter_cache_size / 2)
 {
     const std::string& filter_name = BlockFilterTypeName(filter_type);
     if (filter_name.empty()) throw std::invalid_argument("unknown filter_type");
@@ -121,9 +129,141 @@ bool BlockFilterIndex::Init()
         m_next_filter_pos.nFile = 0;
         m_next_filter_pos.nPos = 0;
     }
+    // Load the header chain before the index starts receiving new blocks
+    if (m_header_chain_max_entries > 0) LoadHeaderChain();
     return BaseIndex::Init();
 }
 
+void BlockFilterIndex::LoadHeaderChain()
+{
+    // Read the height index without cs_main, keeping as many of the most recent entries as fit
+    std::deque<std::pair<uint256, DBVal>> entries;
+    int start_height{0};
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    DBHeightKey key(0);
+    db_it->Seek(key);
+    for (; db_it->Valid() && db_it->GetKey(key) && key.height == start_height + static_cast<int>(entries.size()); db_it->Next()) {
+        std::pair<uint256, DBVal> value;
+        if (!db_it->GetValue(value)) break;
+        entries.push_back(std::move(value));
+        if (entries.size() > m_header_chain_max_entries) {
+            entries.pop_front();
+            ++start_height;
+        }
+    }
+
+    std::deque<CachedHeader> headers;
+    {
+        LOCK(cs_main);
+        // Entries above the best block of the index may belong to a chain that it is going to
+        // rewind, so stop where the entries no longer form a chain
+        for (const auto& [block_hash, value] : entries) {
+            const CBlockIndex* pindex = m_chainstate->m_blockman.LookupBlockIndex(block_hash);
+            if (!pindex || pindex->nHeight != start_height + static_cast<int>(headers.size())) break;
+            if (!headers.empty() && pindex->pprev != headers.back().block) break;
+            headers.push_back({pindex, value.hash, value.header, value.pos});
+        }
+    }
+    LogPrintf("%s: cached %d filter headers from height %d\n", GetName(), headers.size(), start_height);
+    LOCK(m_cs_headers_cache);
+    m_header_chain = std::move(headers);
+    m_header_chain_start = start_height;
+}
+
+void BlockFilterIndex::CacheHeader(const CBlockIndex* pindex, const uint256& filter_hash, const uint256& header, const FlatFilePos& pos)
+{
+    if (m_header_chain_max_entries == 0) return;
+    LOCK(m_cs_headers_cache);
+    const int height = pindex->nHeight;
+    // The chain is only extended; entries above a block being rewritten belong to a stale chain
+    if (height < m_header_chain_start || height > m_header_chain_start + static_cast<int>(m_header_chain.size())) return;
+    m_header_chain.resize(height - m_header_chain_start);
+    if (!m_header_chain.empty() && m_header_chain.back().block != pindex->pprev) return;
+    m_header_chain.push_back({pindex, filter_hash, header, pos});
+    if (m_header_chain.size() > m_header_chain_max_entries) {
+        m_header_chain.pop_front();
+        ++m_header_chain_start;
+    }
+}
+
+bool BlockFilterIndex::LookupCachedRange(int start_height, const CBlockIndex* stop_index, std::vector<CachedHeader>& entries_out, bool count_misses) const
+{
+    if (start_height < 0 || start_height > stop_index->nHeight) return false;
+    const size_t count = stop_index->nHeight - start_height + 1;
+    LOCK(m_cs_headers_cache);
+    const int end_height = m_header_chain_start + static_cast<int>(m_header_chain.size());
+    if (start_height < m_header_chain_start || stop_index->nHeight >= end_height ||
+        m_header_chain[stop_index->nHeight - m_header_chain_start].block != stop_index) {
+        if (count_misses) m_header_misses += count;
+        return false;
+    }
+    // The entries below stop_index are its ancestors, as every entry is the parent of the next
+    m_header_hits += count;
+    entries_out.assign(m_header_chain.begin() + (start_height - m_header_chain_start),
+                       m_header_chain.begin() + (stop_index->nHeight - m_header_chain_start + 1));
+    return true;
+}
+
+bool BlockFilterIndex::ReadFilter(const CBlockIndex* block_index, const FlatFilePos& pos, BlockFilter& filter) const
+{
+    if (m_filter_cache_max_bytes == 0) {
+        return ReadFilterFromDisk(pos, filter);
+    }
+
+    const uint256 block_hash = block_index->GetBlockHash();
+    {
+        LOCK(m_cs_filter_cache);
+        auto it = m_filter_cache.find(block_hash);
+        if (it != m_filter_cache.end()) {
+            ++m_filter_hits;
+            m_filter_lru.splice(m_filter_lru.begin(), m_filter_lru, it->second);
+            filter = *it->second;
+            return true;
+        }
+        ++m_filter_misses;
+    }
+
+    if (!ReadFilterFromDisk(pos, filter)) {
+        return false;
+    }
+
+    const size_t size = filter.GetEncodedFilter().size() + FILTER_CACHE_ENTRY_OVERHEAD;
+    if (size > m_filter_cache_max_bytes) return true;
+    LOCK(m_cs_filter_cache);
+    // Another thread may have added the filter in the meantime
+    if (m_filter_cache.count(block_hash)) return true;
+    while (m_filter_cache_bytes + size > m_filter_cache_max_bytes) {
+        const BlockFilter& evicted = m_filter_lru.back();
+        m_filter_cache_bytes -= evicted.GetEncodedFilter().size() + FILTER_CACHE_ENTRY_OVERHEAD;
+        m_filter_cache.erase(evicted.GetBlockHash());
+        m_filter_lru.pop_back();
+    }
+    m_filter_lru.push_front(filter);
+    m_filter_cache.emplace(block_hash, m_filter_lru.begin());
+    m_filter_cache_bytes += size;
+    return true;
+}
+
+BlockFilterIndex::CacheStats BlockFilterIndex::GetCacheStats() const
+{
+    CacheStats stats;
+    {
+        LOCK(m_cs_filter_cache);
+        stats.filter_entries = m_filter_cache.size();
+        stats.filter_bytes = m_filter_cache_bytes;
+        stats.filter_max_bytes = m_filter_cache_max_bytes;
+        stats.filter_hits = m_filter_hits;
+        stats.filter_misses = m_filter_misses;
+    }
+    LOCK(m_cs_headers_cache);
+    stats.header_entries = m_header_chain.size();
+    stats.header_bytes = m_header_chain.size() * sizeof(CachedHeader);
+    stats.header_max_bytes = m_header_chain_max_entries * sizeof(CachedHeader);
+    stats.header_hits = m_header_hits;
+    stats.header_misses = m_header_misses;
+    return stats;
+}
+
 bool BlockFilterIndex::CommitInternal(CDBBatch& batch)
 {
     const FlatFilePos& pos = m_next_filter_pos;
@@ -207,6 +347,24 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
+/** Read the filter header of the block preceding pindex on the active chain from the height index. */
+static bool ReadPrevFilterHeader(const CDBWrapper& db, const CBlockIndex* pindex, uint256& prev_header)
+{
+    std::pair<uint256, DBVal> read_out;
+    if (!db.Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
+        return false;
+    }
+
+    uint256 expected_block_hash = pindex->pprev->GetBlockHash();
+    if (read_out.first != expected_block_hash) {
+        return error("%s: previous block header belongs to unexpected block %s; expected %s",
+                     __func__, read_out.first.ToString(), expected_block_hash.ToString());
+    }
+
+    prev_header = read_out.second.header;
+    return true;
+}
+
 bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
 {
     CBlockUndo block_undo;
@@ -216,19 +374,9 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
         if (!UndoReadFromDisk(block_undo, pindex)) {
             return false;
         }
-
-        std::pair<uint256, DBVal> read_out;
-        if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
+        if (!ReadPrevFilterHeader(*m_db, pindex, prev_header)) {
             return false;
         }
-
-        uint256 expected_block_hash = pindex->pprev->GetBlockHash();
-        if (read_out.first != expected_block_hash) {
-            return error("%s: previous block header belongs to unexpected block %s; expected %s",
-                         __func__, read_out.first.ToString(), expected_block_hash.ToString());
-        }
-
-        prev_header = read_out.second.header;
     }
 
     BlockFilter filter(m_filter_type, block, block_undo);
@@ -245,11 +393,68 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
     if (!m_db->Write(DBHeightKey(pindex->nHeight), value)) {
         return false;
     }
+    CacheHeader(pindex, value.second.hash, value.second.header, value.second.pos);
 
     m_next_filter_pos.nPos += bytes_written;
     return true;
 }
 
+/** Filter of a block, built ahead of chaining its header to the previous one */
+struct BlockFilterIndex::PreparedFilter : public BaseIndex::PreparedBlock {
+    BlockFilter filter;
+};
+
+std::unique_ptr<BaseIndex::PreparedBlock> BlockFilterIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return nullptr;
+    }
+    auto prepared = std::make_unique<PreparedFilter>();
+    prepared->filter = BlockFilter(m_filter_type, block, block_undo);
+    return prepared;
+}
+
+bool BlockFilterIndex::WritePreparedBlocks(const std::vector<std::unique_ptr<PreparedBlock>>& blocks)
+{
+    // Headers commit to the previous header, so they are computed here in order
+    uint256 prev_header;
+    const CBlockIndex* first = blocks.front()->pindex;
+    if (first->nHeight > 0 && !ReadPrevFilterHeader(*m_db, first, prev_header)) {
+        return false;
+    }
+
+    CDBBatch batch(*m_db);
+    FlatFilePos pos = m_next_filter_pos;
+    std::vector<DBVal> values;
+    values.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        const BlockFilter& filter = static_cast<const PreparedFilter&>(*block).filter;
+        size_t bytes_written = WriteFilterToDisk(pos, filter);
+        if (bytes_written == 0) return false;
+
+        std::pair<uint256, DBVal> value;
+        value.first = block->pindex->GetBlockHash();
+        value.second.hash = filter.GetHash();
+        value.second.header = filter.ComputeHeader(prev_header);
+        value.second.pos = pos;
+        batch.Write(DBHeightKey(block->pindex->nHeight), value);
+        values.push_back(value.second);
+
+        prev_header = value.second.header;
+        pos.nPos += bytes_written;
+    }
+
+    if (!m_db->WriteBatch(batch)) {
+        return false;
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        CacheHeader(blocks[i]->pindex, values[i].hash, values[i].header, values[i].pos);
+    }
+    m_next_filter_pos = pos;
+    return true;
+}
+
 static bool CopyHeightIndexToHashIndex(CDBIterator& db_it, CDBBatch& batch,
                                        const std::string& index_name,
                                        int start_height, int stop_height)
@@ -296,6 +501,18 @@ bool BlockFilterIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex*
     batch.Write(DB_FILTER_POS, m_next_filter_pos);
     if (!m_db->WriteBatch(batch)) return false;
 
+    // The filters of the disconnected blocks stay valid and cached, only their heights change
+    {
+        LOCK(m_cs_headers_cache);
+        const int end_height = new_tip->nHeight + 1;
+        if (end_height < m_header_chain_start) {
+            m_header_chain.clear();
+            m_header_chain_start = end_height;
+        } else if (m_header_chain.size() > static_cast<size_t>(end_height - m_header_chain_start)) {
+            m_header_chain.resize(end_height - m_header_chain_start);
+        }
+    }
+
     return BaseIndex::Rewind(current_tip, new_tip);
 }
 
@@ -374,16 +591,27 @@ static bool LookupRange(CDBWrapper& db, const std::string& index_name, int start
 
 bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
 {
+    std::vector<CachedHeader> cached;
+    if (m_header_chain_max_entries > 0 && LookupCachedRange(block_index->nHeight, block_index, cached)) {
+        return ReadFilter(block_index, cached[0].pos, filter_out);
+    }
+
     DBVal entry;
     if (!LookupOne(*m_db, block_index, entry)) {
         return false;
     }
 
-    return ReadFilterFromDisk(entry.pos, filter_out);
+    return ReadFilter(block_index, entry.pos, filter_out);
 }
 
 bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out)
 {
+    std::vector<CachedHeader> cached;
+    if (m_header_chain_max_entries > 0 && LookupCachedRange(block_index->nHeight, block_index, cached, /* count_misses */ false)) {
+        header_out = cached[0].header;
+        return true;
+    }
+
     LOCK(m_cs_headers_cache);
 
     bool is_checkpoint{block_index->nHeight % CFCHECKPT_INTERVAL == 0};
@@ -392,11 +620,13 @@ bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint25
         // Try to find the block in the headers cache if this is a checkpoint height.
         auto header = m_headers_cache.find(block_index->GetBlockHash());
         if (header != m_headers_cache.end()) {
+            if (m_header_chain_max_entries > 0) ++m_header_hits;
             header_out = header->second;
             return true;
         }
     }
 
+    if (m_header_chain_max_entries > 0) ++m_header_misses;
     DBVal entry;
     if (!LookupOne(*m_db, block_index, entry)) {
         return false;
@@ -415,18 +645,26 @@ bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint25
 bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* stop_index,
                                          std::vector<BlockFilter>& filters_out) const
 {
-    std::vector<DBVal> entries;
-    if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
-        return false;
+    std::vector<FlatFilePos> positions;
+    std::vector<CachedHeader> cached;
+    if (m_header_chain_max_entries > 0 && LookupCachedRange(start_height, stop_index, cached)) {
+        positions.reserve(cached.size());
+        for (const auto& entry : cached) positions.push_back(entry.pos);
+    } else {
+        std::vector<DBVal> entries;
+        if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
+            return false;
+        }
+        positions.reserve(entries.size());
+        for (const auto& entry : entries) positions.push_back(entry.pos);
     }
 
-    filters_out.resize(entries.size());
-    auto filter_pos_it = filters_out.begin();
-    for (const auto& entry : entries) {
-        if (!ReadFilterFromDisk(entry.pos, *filter_pos_it)) {
+    filters_out.resize(positions.size());
+    const CBlockIndex* block_index = stop_index;
+    for (size_t i = positions.size(); i-- > 0; block_index = block_index->pprev) {
+        if (!ReadFilter(block_index, positions[i], filters_out[i])) {
             return false;
         }
-        ++filter_pos_it;
     }
 
     return true;
@@ -436,6 +674,16 @@ bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex
                                              std::vector<uint256>& hashes_out) const
 
 {
+    std::vector<CachedHeader> cached;
+    if (m_header_chain_max_entries > 0 && LookupCachedRange(start_height, stop_index, cached)) {
+        hashes_out.clear();
+        hashes_out.reserve(cached.size());
+        for (const auto& entry : cached) {
+            hashes_out.push_back(entry.filter_hash);
+        }
+        return true;
+    }
+
     std::vector<DBVal> entries;
     if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
         return false;
@@ -461,12 +709,14 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn)
 }
 
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory, bool f_wipe)
+                          size_t n_cache_size, bool f_memory, bool f_wipe,
+                          size_t filter_cache_size)
 {
     auto result = g_filter_indexes.emplace(std::piecewise_construct,
                                            std::forward_as_tuple(filter_type),
                                            std::forward_as_tuple(filter_type,
-                                                                 n_cache_size, f_memory, f_wipe));
+                                                                 n_cache_size, f_memory, f_wipe,
+                                                                 filter_cache_size));
     return result.second;
 }
 
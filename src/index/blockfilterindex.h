@@ -11,9 +11,17 @@
 #include <index/base.h>
 #include <util/hasher.h>
 
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
 /** Interval between compact filter checkpoints. See BIP 157. */
 static constexpr int CFCHECKPT_INTERVAL = 1000;
 
+/** Default for -blockfiltercachesize when -peerblockfilters is set, in MiB */
+static constexpr int64_t DEFAULT_BLOCK_FILTER_CACHE_SIZE{32};
+
 /**
  * BlockFilterIndex is used to store and retrieve block filters, hashes, and headers for a range of
  * blocks by height. An index is constructed for each supported filter type with its own database
@@ -34,17 +42,62 @@ private:
     bool ReadFilterFromDisk(const FlatFilePos& pos, BlockFilter& filter) const;
     size_t WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter);
 
-    Mutex m_cs_headers_cache;
+    /** Filter hash, header and filter position of a block in the height index */
+    struct CachedHeader {
+        const CBlockIndex* block;
+        uint256 filter_hash;
+        uint256 header;
+        FlatFilePos pos;
+    };
+
+    mutable Mutex m_cs_headers_cache;
     /** cache of block hash to filter header, to avoid disk access when responding to getcfcheckpt. */
     std::unordered_map<uint256, uint256, FilterHeaderHasher> m_headers_cache GUARDED_BY(m_cs_headers_cache);
+    /** The most recent entries of the height index by height, starting at m_header_chain_start,
+     *  each block being the parent of the next. Only kept if the filter cache is enabled, and
+     *  looked at before the checkpoint cache. */
+    std::deque<CachedHeader> m_header_chain GUARDED_BY(m_cs_headers_cache);
+    int m_header_chain_start GUARDED_BY(m_cs_headers_cache){0};
+    /** Maximum number of entries in m_header_chain, from its share of the cache size */
+    const size_t m_header_chain_max_entries;
+    mutable uint64_t m_header_hits GUARDED_BY(m_cs_headers_cache){0};
+    mutable uint64_t m_header_misses GUARDED_BY(m_cs_headers_cache){0};
+
+    /** Maximum total size of the cached filters; 0 disables the filter cache */
+    const size_t m_filter_cache_max_bytes;
+    mutable Mutex m_cs_filter_cache;
+    /** Recently looked up filters, most recently used first */
+    mutable std::list<BlockFilter> m_filter_lru GUARDED_BY(m_cs_filter_cache);
+    mutable std::unordered_map<uint256, std::list<BlockFilter>::iterator, BlockHasher> m_filter_cache GUARDED_BY(m_cs_filter_cache);
+    mutable size_t m_filter_cache_bytes GUARDED_BY(m_cs_filter_cache){0};
+    mutable uint64_t m_filter_hits GUARDED_BY(m_cs_filter_cache){0};
+    mutable uint64_t m_filter_misses GUARDED_BY(m_cs_filter_cache){0};
+
+    /** Fill m_header_chain from the most recent entries of the height index. */
+    void LoadHeaderChain() LOCKS_EXCLUDED(m_cs_headers_cache);
+    /** Add the entry just written to the height index for a block to m_header_chain. */
+    void CacheHeader(const CBlockIndex* pindex, const uint256& filter_hash, const uint256& header, const FlatFilePos& pos) LOCKS_EXCLUDED(m_cs_headers_cache);
+    /** Look up the entries of the ancestors of stop_index from start_height in m_header_chain.
+     *  If they are not all there, count them as misses unless the caller tries another cache first. */
+    bool LookupCachedRange(int start_height, const CBlockIndex* stop_index, std::vector<CachedHeader>& entries_out, bool count_misses = true) const LOCKS_EXCLUDED(m_cs_headers_cache);
+    /** Read a filter from the filter cache, or from disk and add it to the cache. */
+    bool ReadFilter(const CBlockIndex* block_index, const FlatFilePos& pos, BlockFilter& filter) const LOCKS_EXCLUDED(m_cs_filter_cache);
 
 protected:
+    struct PreparedFilter;
+
     bool Init() override;
 
     bool CommitInternal(CDBBatch& batch) override;
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool AllowParallelSync() const override { return true; }
+
+    std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool WritePreparedBlocks(const std::vector<std::unique_ptr<PreparedBlock>>& blocks) override;
+
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
     BaseIndex::DB& GetDB() const override { return *m_db; }
@@ -54,7 +107,24 @@ protected:
 public:
     /** Constructs the index, which becomes available to be queried. */
     explicit BlockFilterIndex(BlockFilterType filter_type,
-                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                              size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                              size_t filter_cache_size = 0);
+
+    struct CacheStats {
+        size_t filter_entries{0};
+        size_t filter_bytes{0};
+        size_t filter_max_bytes{0};
+        uint64_t filter_hits{0};
+        uint64_t filter_misses{0};
+        size_t header_entries{0};
+        size_t header_bytes{0};
+        size_t header_max_bytes{0};
+        uint64_t header_hits{0};
+        uint64_t header_misses{0};
+    };
+
+    /** Get the size and hit counts of the filter and filter header caches. */
+    CacheStats GetCacheStats() const;
 
     BlockFilterType GetFilterType() const { return m_filter_type; }
 
@@ -87,7 +157,8 @@ void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn);
  * a new index is created and false if one has already been initialized.
  */
 bool InitBlockFilterIndex(BlockFilterType filter_type,
-                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+                          size_t n_cache_size, bool f_memory = false, bool f_wipe = false,
+                          size_t filter_cache_size = 0);
 
 /**
  * Destroy the block filter index with the given type. Returns false if no such index exists. This
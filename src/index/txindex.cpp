@@ -211,18 +211,46 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+/** Positions of the transactions of a block, to be written to the index */
+struct TxIndex::PreparedTxs : public BaseIndex::PreparedBlock {
+    std::vector<std::pair<uint256, CDiskTxPos>> tx_pos;
+};
+
+static void AppendTxPositions(const CBlock& block, const CBlockIndex* pindex, std::vector<std::pair<uint256, CDiskTxPos>>& vPos)
 {
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return;
 
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
+    vPos.reserve(vPos.size() + block.vtx.size());
     for (const auto& tx : block.vtx) {
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
+}
+
+bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    AppendTxPositions(block, pindex, vPos);
+    return vPos.empty() || m_db->WriteTxs(vPos);
+}
+
+std::unique_ptr<BaseIndex::PreparedBlock> TxIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    auto prepared = std::make_unique<PreparedTxs>();
+    AppendTxPositions(block, pindex, prepared->tx_pos);
+    return prepared;
+}
+
+bool TxIndex::WritePreparedBlocks(const std::vector<std::unique_ptr<PreparedBlock>>& blocks)
+{
+    // Write the transactions of all the blocks in a single batch
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+    for (const auto& block : blocks) {
+        const auto& tx_pos = static_cast<const PreparedTxs&>(*block).tx_pos;
+        vPos.insert(vPos.end(), tx_pos.begin(), tx_pos.end());
+    }
     return m_db->WriteTxs(vPos);
 }
 
@@ -18,6 +18,7 @@ class TxIndex final : public BaseIndex
 {
 protected:
     class DB;
+    struct PreparedTxs;
 
 private:
     const std::unique_ptr<DB> m_db;
@@ -28,6 +29,12 @@ protected:
 
     bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
 
+    bool AllowParallelSync() const override { return true; }
+
+    std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool WritePreparedBlocks(const std::vector<std::unique_ptr<PreparedBlock>>& blocks) override;
+
     BaseIndex::DB& GetDB() const override;
 
     const char* GetName() const override { return "txindex"; }
@@ -6,6 +6,7 @@
 #define BITCOINDX_MEMUSAGE_H
 
 #include <indirectmap.h>
+#include <openhashmap.h>
 #include <prevector.h>
 
 #include <stdlib.h>
@@ -155,6 +156,15 @@ private:
     void* ptr;
 };
 
+// OpenHashMap has separate arrays of bucket pointers and control bytes, and carves its nodes out of
+// chunks, which it keeps in a vector
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const OpenHashMap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(void*) * m.bucket_count()) + MallocUsage(m.bucket_count()) + MallocUsage(OpenHashMap<X, Y, Z>::CHUNK_BYTES) * m.chunk_count() + MallocUsage(sizeof(void*) * m.chunk_capacity());
+}
+
 template<typename X, typename Y>
 static inline size_t DynamicUsage(const std::unordered_set<X, Y>& s)
 {
@@ -41,6 +41,14 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
 #include <algorithm>
 #include <array>
 #include <cstdint>
@@ -97,6 +105,20 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifndef WIN32
+/** Maximum number of send queue entries handed to a single sendmsg() call */
+static constexpr size_t MAX_SEND_IOVECS = 64;
+#endif
+
+#ifdef USE_EPOLL
+/** Maximum number of events to retrieve with a single epoll_wait() call */
+static constexpr int MAX_EPOLL_EVENTS = 256;
+/** How often (in seconds) EpollSocketHandler() checks all peers for inactivity */
+static constexpr int64_t EPOLL_INACTIVITY_CHECK_INTERVAL = 1;
+/** Marks epoll events of listening sockets, whose index in vhListenSocket makes up the other bits */
+static constexpr uint64_t EPOLL_LISTEN_SOCKET_FLAG = uint64_t{1} << 63;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -769,12 +791,18 @@ std::optional<CNetMessage> V1TransportDeserializer::GetMessage(const std::chrono
     return msg;
 }
 
+const uint256& SharedNetPayload::GetHash() const
+{
+    std::call_once(m_hash_once, [this] { m_hash = Hash(m_bytes); });
+    return m_hash;
+}
+
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) {
     // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    uint256 hash = msg.m_shared_payload ? msg.m_shared_payload->GetHash() : Hash(msg.data);
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -788,27 +816,63 @@ size_t CConnman::SocketSendData(CNode& node) const
     size_t nSentSize = 0;
 
     while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > node.nSendOffset);
         int nBytes = 0;
+        size_t nBytesQueued = 0;
+#ifndef WIN32
+        // Hand as much of the queue as possible to a single sendmsg() call, so
+        // that a message header and its payload go out together and shared
+        // payloads are sent straight from where they are stored.
+        std::array<struct iovec, MAX_SEND_IOVECS> iov;
+        size_t iov_count = 0;
+        size_t offset = node.nSendOffset;
+        for (auto iov_it = it; iov_it != node.vSendMsg.end() && iov_count < iov.size(); ++iov_it) {
+            const Span<const unsigned char> data = iov_it->Bytes();
+            assert(data.size() > offset);
+            iov[iov_count].iov_base = const_cast<unsigned char*>(data.data() + offset);
+            iov[iov_count].iov_len = data.size() - offset;
+            nBytesQueued += data.size() - offset;
+            offset = 0;
+            ++iov_count;
+        }
+        struct msghdr msg{};
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = iov_count;
+        {
+            LOCK(node.cs_hSocket);
+            if (node.hSocket == INVALID_SOCKET)
+                break;
+            nBytes = sendmsg(node.hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+#else
+        const Span<const unsigned char> data = it->Bytes();
+        assert(data.size() > node.nSendOffset);
+        nBytesQueued = data.size() - node.nSendOffset;
         {
             LOCK(node.cs_hSocket);
             if (node.hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(node.hSocket, reinterpret_cast<const char*>(data.data()) + node.nSendOffset, data.size() - node.nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = send(node.hSocket, reinterpret_cast<const char*>(data.data()) + node.nSendOffset, nBytesQueued, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
+#endif
         if (nBytes > 0) {
             node.nLastSend = GetTimeSeconds();
             node.nSendBytes += nBytes;
-            node.nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (node.nSendOffset == data.size()) {
-                node.nSendOffset = 0;
-                node.nSendSize -= data.size();
-                node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+            size_t nBytesLeft = nBytes;
+            while (nBytesLeft > 0) {
+                const size_t nEntrySize = it->size();
+                const size_t nAdvance = std::min(nBytesLeft, nEntrySize - node.nSendOffset);
+                node.nSendOffset += nAdvance;
+                nBytesLeft -= nAdvance;
+                if (node.nSendOffset == nEntrySize) {
+                    node.nSendOffset = 0;
+                    node.nSendSize -= nEntrySize;
+                    node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+                    it++;
+                }
+            }
+            if (static_cast<size_t>(nBytes) < nBytesQueued) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1201,6 +1265,7 @@ void CConnman::CreateNodeFromAcceptedSocket(SOCKET hSocket,
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    RegisterNodeSocket(*pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1286,7 +1351,7 @@ void CConnman::DisconnectNodes()
         for (CNode* pnode : vNodesDisconnectedCopy)
         {
             // Destroy the object only after other threads have stopped using it.
-            if (pnode->GetRefCount() <= 0) {
+            if (UnregisterNodeSocket(*pnode)) {
                 vNodesDisconnected.remove(pnode);
                 DeleteNode(pnode);
             }
@@ -1345,16 +1410,20 @@ bool CConnman::InactivityCheck(const CNode& node) const
     return false;
 }
 
-bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+bool CConnman::GenerateSelectSet(const SocketShard& shard, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
-    for (const ListenSocket& hListenSocket : vhListenSocket) {
-        recv_set.insert(hListenSocket.socket);
+    if (IsPrimarySocketShard(shard)) {
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            recv_set.insert(hListenSocket.socket);
+        }
     }
 
     {
         LOCK(cs_vNodes);
         for (CNode* pnode : vNodes)
         {
+            if (&GetSocketShard(*pnode) != &shard) continue;
+
             // Implement the following logic:
             // * If there is data to send, select() for sending data. As this only
             //   happens when optimistic write failed, we choose to first drain the
@@ -1392,10 +1461,10 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
 }
 
 #ifdef USE_POLL
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEvents(const SocketShard& shard, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(shard, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1434,10 +1503,10 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
     }
 }
 #else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEvents(const SocketShard& shard, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
-    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+    if (!GenerateSelectSet(shard, recv_select_set, send_select_set, error_select_set)) {
         interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
         return;
     }
@@ -1509,10 +1578,284 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
-void CConnman::SocketHandler()
+void CConnman::InitSocketShards(int count)
+{
+    count = std::clamp(count, 1, MAX_SOCKET_THREADS);
+    if (m_socket_shards.size() == static_cast<size_t>(count)) return;
+    m_socket_shards.clear();
+    for (int i = 0; i < count; ++i) {
+        auto shard = std::make_unique<SocketShard>(i);
+#ifdef USE_EPOLL
+        shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (shard->epoll_fd == INVALID_SOCKET) {
+            LogPrintf("Failed to create epoll instance, falling back to poll(): %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+#endif
+        m_socket_shards.push_back(std::move(shard));
+    }
+}
+
+CConnman::SocketShard::~SocketShard()
+{
+#ifdef USE_EPOLL
+    if (epoll_fd != INVALID_SOCKET) close(epoll_fd);
+#endif
+}
+
+CConnman::SocketShard& CConnman::GetSocketShard(const CNode& node) const
+{
+    return *m_socket_shards[static_cast<size_t>(node.GetId()) % m_socket_shards.size()];
+}
+
+bool CConnman::UseEpoll() const
+{
+#ifdef USE_EPOLL
+    return m_use_epoll && std::all_of(m_socket_shards.begin(), m_socket_shards.end(),
+        [](const auto& shard) { return shard->epoll_fd != INVALID_SOCKET; });
+#else
+    return false;
+#endif
+}
+
+void CConnman::RegisterNodeSocket(CNode& node)
+{
+#ifdef USE_EPOLL
+    if (!UseEpoll()) return;
+    SocketShard& shard = GetSocketShard(node);
+    LOCK2(shard.cs_nodes, node.cs_hSocket);
+    if (node.hSocket == INVALID_SOCKET) return;
+    // Interest in both directions stays registered for the lifetime of the
+    // socket. Being edge-triggered, EPOLLOUT only fires when a full send
+    // buffer gains room again, or when RearmSendEvent() asks for it.
+    struct epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.u64 = static_cast<uint64_t>(node.GetId());
+    shard.nodes.emplace(node.GetId(), &node);
+    if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, node.hSocket, &event) != 0) {
+        LogPrintf("Failed to register socket of peer=%d with epoll: %s\n", node.GetId(), NetworkErrorString(WSAGetLastError()));
+        node.CloseSocketDisconnect();
+    }
+#endif
+}
+
+void CConnman::RearmSendEvent(CNode& node)
+{
+#ifdef USE_EPOLL
+    if (!UseEpoll()) return;
+    SocketShard& shard = GetSocketShard(node);
+    LOCK(node.cs_hSocket);
+    if (node.hSocket == INVALID_SOCKET) return;
+    // Modifying the registration makes epoll check the socket again, so a send
+    // that was interrupted, or a buffer that had room again before the
+    // EPOLLOUT edge could be seen, still produces an event.
+    struct epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.u64 = static_cast<uint64_t>(node.GetId());
+    if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_MOD, node.hSocket, &event) != 0) {
+        LogPrint(BCLog::NET, "Failed to re-arm socket of peer=%d with epoll: %s\n", node.GetId(), NetworkErrorString(WSAGetLastError()));
+    }
+#endif
+}
+
+bool CConnman::UnregisterNodeSocket(CNode& node)
+{
+#ifdef USE_EPOLL
+    // Holding cs_nodes keeps the shard's thread from taking a new reference
+    // to the peer between the reference count check and the removal.
+    SocketShard& shard = GetSocketShard(node);
+    LOCK(shard.cs_nodes);
+    if (node.GetRefCount() > 0) return false;
+    shard.nodes.erase(node.GetId());
+    return true;
+#else
+    return node.GetRefCount() <= 0;
+#endif
+}
+
+#ifdef USE_EPOLL
+void CConnman::RegisterListenSockets()
+{
+    if (!UseEpoll()) return;
+    // Listening sockets are served by the primary shard.
+    for (size_t i = 0; i < vhListenSocket.size(); ++i) {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = EPOLL_LISTEN_SOCKET_FLAG | i;
+        if (epoll_ctl(m_socket_shards.front()->epoll_fd, EPOLL_CTL_ADD, vhListenSocket[i].socket, &event) != 0) {
+            LogPrintf("Failed to register listening socket with epoll: %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+    }
+}
+
+bool CConnman::IsSocketActionable(CNode& node, uint32_t events) const
+{
+    if (events & (EPOLLERR | EPOLLHUP)) return true;
+    if (events & EPOLLOUT) return true;
+    if (!(events & EPOLLIN) || node.fPauseRecv) return false;
+    LOCK(node.cs_vSend);
+    return node.vSendMsg.empty();
+}
+
+void CConnman::EpollSocketHandler(SocketShard& shard)
+{
+    const auto add_events = [&shard](CNode* pnode, uint32_t events) {
+        auto [it, inserted] = shard.events.try_emplace(pnode, 0);
+        if (inserted) pnode->AddRef();
+        it->second |= events;
+    };
+
+    // Events left over from earlier iterations that can be acted on now must
+    // not wait for a new edge, so don't block in that case.
+    const bool have_ready = std::any_of(shard.events.begin(), shard.events.end(),
+        [this](const auto& entry) { return IsSocketActionable(*entry.first, entry.second); });
+
+    std::array<struct epoll_event, MAX_EPOLL_EVENTS> events;
+    int num_events = epoll_wait(shard.epoll_fd, events.data(), events.size(), have_ready ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+    if (interruptNet) return;
+    if (num_events < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        num_events = 0;
+    }
+
+    {
+        LOCK(shard.cs_nodes);
+        for (int i = 0; i < num_events; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id & EPOLL_LISTEN_SOCKET_FLAG) continue;
+            const auto it = shard.nodes.find(static_cast<NodeId>(id));
+            if (it != shard.nodes.end()) add_events(it->second, events[i].events);
+        }
+    }
+
+    for (int i = 0; i < num_events; ++i) {
+        const uint64_t id = events[i].data.u64;
+        if (id & EPOLL_LISTEN_SOCKET_FLAG) {
+            AcceptConnection(vhListenSocket.at(id & ~EPOLL_LISTEN_SOCKET_FLAG));
+        }
+    }
+
+    for (auto it = shard.events.begin(); it != shard.events.end();) {
+        if (interruptNet) return;
+
+        CNode* pnode = it->first;
+        uint32_t& pending = it->second;
+        const bool send_pending = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+
+        // Same rules as GenerateSelectSet(): errors are always read from, but
+        // otherwise a peer is only read from once its send queue is empty and
+        // while its receive is not paused.
+        if ((pending & (EPOLLERR | EPOLLHUP)) || ((pending & EPOLLIN) && !send_pending && !pnode->fPauseRecv)) {
+            if (!SocketRecvData(*pnode)) pending &= ~EPOLLIN;
+            pending &= ~(EPOLLERR | EPOLLHUP);
+        }
+
+        if (pending & EPOLLOUT) {
+            size_t bytes_sent;
+            bool send_left;
+            {
+                LOCK(pnode->cs_vSend);
+                bytes_sent = SocketSendData(*pnode);
+                send_left = !pnode->vSendMsg.empty();
+            }
+            if (bytes_sent) RecordBytesSent(bytes_sent);
+            pending &= ~EPOLLOUT;
+            if (send_left) RearmSendEvent(*pnode);
+        }
+
+        if (pending == 0 || WITH_LOCK(pnode->cs_hSocket, return pnode->hSocket == INVALID_SOCKET)) {
+            it = shard.events.erase(it);
+            WITH_LOCK(cs_vNodes, pnode->Release());
+        } else {
+            ++it;
+        }
+    }
+
+    const int64_t now = GetTimeSeconds();
+    if (now >= shard.next_inactivity_check) {
+        shard.next_inactivity_check = now + EPOLL_INACTIVITY_CHECK_INTERVAL;
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            if (&GetSocketShard(*pnode) != &shard) continue;
+            if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
+        }
+    }
+}
+#endif
+
+bool CConnman::SocketRecvData(CNode& node)
+{
+    // typical socket buffer is 8K-64K
+    uint8_t pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(node.cs_hSocket);
+        if (node.hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(node.hSocket, (char*)pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!node.ReceiveMsgBytes(Span<const uint8_t>(pchBuf, nBytes), notify))
+            node.CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(node.vRecvMsg.begin());
+            for (; it != node.vRecvMsg.end(); ++it) {
+                // vRecvMsg contains only completed CNetMessage
+                // the single possible partially deserialized message are held by TransportDeserializer
+                nSizeAdded += it->m_raw_message_size;
+            }
+            {
+                LOCK(node.cs_vProcessMsg);
+                node.vProcessMsg.splice(node.vProcessMsg.end(), node.vRecvMsg, node.vRecvMsg.begin(), it);
+                node.nProcessQueueSize += nSizeAdded;
+                node.fPauseRecv = node.nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+        return static_cast<size_t>(nBytes) == sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!node.fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed for peer=%d\n", node.GetId());
+        }
+        node.CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!node.fDisconnect) {
+                LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", node.GetId(), NetworkErrorString(nErr));
+            }
+            node.CloseSocketDisconnect();
+        }
+        return nErr == WSAEINTR;
+    }
+    return false;
+}
+
+void CConnman::SocketHandler(SocketShard& shard)
 {
+#ifdef USE_EPOLL
+    if (UseEpoll()) {
+        EpollSocketHandler(shard);
+        return;
+    }
+#endif
+
     std::set<SOCKET> recv_set, send_set, error_set;
-    SocketEvents(recv_set, send_set, error_set);
+    SocketEvents(shard, recv_set, send_set, error_set);
 
     if (interruptNet) return;
 
@@ -1533,9 +1876,11 @@ void CConnman::SocketHandler()
     std::vector<CNode*> vNodesCopy;
     {
         LOCK(cs_vNodes);
-        vNodesCopy = vNodes;
-        for (CNode* pnode : vNodesCopy)
+        for (CNode* pnode : vNodes) {
+            if (&GetSocketShard(*pnode) != &shard) continue;
             pnode->AddRef();
+            vNodesCopy.push_back(pnode);
+        }
     }
     for (CNode* pnode : vNodesCopy)
     {
@@ -1556,60 +1901,8 @@ void CConnman::SocketHandler()
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
         }
-        if (recvSet || errorSet)
-        {
-            // typical socket buffer is 8K-64K
-            uint8_t pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, (char*)pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(Span<const uint8_t>(pchBuf, nBytes), notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        // vRecvMsg contains only completed CNetMessage
-                        // the single possible partially deserialized message are held by TransportDeserializer
-                        nSizeAdded += it->m_raw_message_size;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed for peer=%d\n", pnode->GetId());
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect) {
-                        LogPrint(BCLog::NET, "socket recv error for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(nErr));
-                    }
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+        if (recvSet || errorSet) {
+            SocketRecvData(*pnode);
         }
 
         if (sendSet) {
@@ -1627,13 +1920,16 @@ void CConnman::SocketHandler()
     }
 }
 
-void CConnman::ThreadSocketHandler()
+void CConnman::ThreadSocketHandler(SocketShard& shard)
 {
+    const bool primary = IsPrimarySocketShard(shard);
     while (!interruptNet)
     {
-        DisconnectNodes();
-        NotifyNumConnectionsChanged();
-        SocketHandler();
+        if (primary) {
+            DisconnectNodes();
+            NotifyNumConnectionsChanged();
+        }
+        SocketHandler(shard);
     }
 }
 
@@ -2225,6 +2521,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         grantOutbound->MoveTo(pnode->grantOutbound);
 
     m_msgproc->InitializeNode(pnode);
+    RegisterNodeSocket(*pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -2519,6 +2816,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         }
         return false;
     }
+#ifdef USE_EPOLL
+    RegisterListenSockets();
+#endif
 
     proxyType i2p_sam;
     if (GetProxy(NET_I2P, i2p_sam)) {
@@ -2582,7 +2882,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&util::TraceThread, "net", [this] { ThreadSocketHandler(); });
+    for (const auto& shard : m_socket_shards) {
+        SocketShard& shard_ref = *shard;
+        shard_ref.thread = std::thread(&util::TraceThread, shard_ref.thread_name.c_str(), [this, &shard_ref] { ThreadSocketHandler(shard_ref); });
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", DEFAULT_DNSSEED))
         LogPrintf("DNS seeding disabled\n");
@@ -2672,8 +2975,10 @@ void CConnman::StopThreads()
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (const auto& shard : m_socket_shards) {
+        if (shard->thread.joinable())
+            shard->thread.join();
+    }
 }
 
 void CConnman::StopNodes()
@@ -2692,6 +2997,14 @@ void CConnman::StopNodes()
         }
     }
 
+#ifdef USE_EPOLL
+    // The socket handler threads have stopped; drop what they kept of peers.
+    for (const auto& shard : m_socket_shards) {
+        shard->events.clear();
+        WITH_LOCK(shard->cs_nodes, shard->nodes.clear());
+    }
+#endif
+
     // Delete peer connections.
     std::vector<CNode*> nodes;
     WITH_LOCK(cs_vNodes, nodes.swap(vNodes));
@@ -3016,10 +3329,10 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.m_type), nMessageSize, pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /* incoming */ false);
+        CaptureMessage(pnode->addr, msg.m_type, msg.Payload(), /* incoming */ false);
     }
 
     // make sure we use the appropriate network transport format
@@ -3028,6 +3341,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     size_t nTotalSize = nMessageSize + serializedHeader.size();
 
     size_t nBytesSent = 0;
+    bool fSendLeft = false;
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(pnode->vSendMsg.empty());
@@ -3037,13 +3351,24 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.m_shared_payload) {
+                pnode->vSendMsg.emplace_back(std::move(msg.m_shared_payload));
+            } else {
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+            }
+        }
 
         // If write queue empty, attempt "optimistic write"
-        if (optimisticSend) nBytesSent = SocketSendData(*pnode);
+        if (optimisticSend) {
+            nBytesSent = SocketSendData(*pnode);
+            fSendLeft = !pnode->vSendMsg.empty();
+        }
     }
     if (nBytesSent) RecordBytesSent(nBytesSent);
+    // Let the socket handler finish what the optimistic write couldn't send
+    if (fSendLeft) RearmSendEvent(*pnode);
 }
 
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
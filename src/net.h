@@ -25,6 +25,7 @@
 #include <streams.h>
 #include <sync.h>
 #include <threadinterrupt.h>
+#include <tinyformat.h>
 #include <uint256.h>
 #include <util/check.h>
 
@@ -34,8 +35,10 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 class CScheduler;
@@ -76,6 +79,10 @@ static constexpr uint64_t DEFAULT_MAX_UPLOAD_TARGET = 0;
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -socketthreads default */
+static const int DEFAULT_SOCKET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_SOCKET_THREADS = 16;
 /** Number of file descriptors required for message capture **/
 static const int NUM_FDS_MESSAGE_CAPTURE = 1;
 
@@ -98,6 +105,26 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/**
+ * An immutable message payload, such as a serialized block, that can be
+ * queued for any number of peers without being copied. The checksum for the
+ * message header is computed once, on first use.
+ */
+class SharedNetPayload
+{
+public:
+    explicit SharedNetPayload(std::vector<unsigned char> bytes) : m_bytes(std::move(bytes)) {}
+
+    Span<const unsigned char> Bytes() const { return m_bytes; }
+    /** Hash(Bytes()), the first bytes of which are the message checksum. */
+    const uint256& GetHash() const;
+
+private:
+    const std::vector<unsigned char> m_bytes;
+    mutable std::once_flag m_hash_once;
+    mutable uint256 m_hash;
+};
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -109,6 +136,25 @@ struct CSerializedNetMsg
 
     std::vector<unsigned char> data;
     std::string m_type;
+    /** Payload shared with other messages, sent instead of `data` if set. */
+    std::shared_ptr<const SharedNetPayload> m_shared_payload;
+
+    Span<const unsigned char> Payload() const { return m_shared_payload ? m_shared_payload->Bytes() : Span<const unsigned char>{data}; }
+};
+
+/** An entry of a peer's send queue: either an owned buffer or a shared payload. */
+class NetSendBuffer
+{
+public:
+    explicit NetSendBuffer(std::vector<unsigned char> bytes) : m_owned(std::move(bytes)) {}
+    explicit NetSendBuffer(std::shared_ptr<const SharedNetPayload> payload) : m_shared(std::move(payload)) {}
+
+    Span<const unsigned char> Bytes() const { return m_shared ? m_shared->Bytes() : Span<const unsigned char>{m_owned}; }
+    size_t size() const { return Bytes().size(); }
+
+private:
+    std::vector<unsigned char> m_owned;
+    std::shared_ptr<const SharedNetPayload> m_shared;
 };
 
 /** Different types of connections to a peer. This enum encapsulates the
@@ -408,7 +454,7 @@ public:
     /** Offset inside the first vSendMsg already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<NetSendBuffer> vSendMsg GUARDED_BY(cs_vSend);
     Mutex cs_vSend;
     Mutex cs_hSocket;
     Mutex cs_vRecv;
@@ -693,7 +739,7 @@ private:
     //! service advertisements.
     const ServiceFlags nLocalServices;
 
-    std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+    std::list<CNetMessage> vRecvMsg;  // Used only by the node's socket handler thread
 
     mutable RecursiveMutex cs_addrName;
     std::string addrName GUARDED_BY(cs_addrName);
@@ -776,6 +822,11 @@ public:
         std::vector<std::string> m_added_nodes;
         std::vector<bool> m_asmap;
         bool m_i2p_accept_incoming;
+        /// Wait for socket events with epoll where available instead of
+        /// rebuilding a poll() set of every peer on each iteration.
+        bool m_use_epoll = true;
+        /// Number of socket handler threads peers are spread over.
+        int m_socket_threads = DEFAULT_SOCKET_THREADS;
     };
 
     void Init(const Options& connOptions) {
@@ -793,6 +844,8 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_use_epoll = connOptions.m_use_epoll;
+        InitSocketShards(connOptions.m_socket_threads);
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
@@ -993,10 +1046,84 @@ private:
     void NotifyNumConnectionsChanged();
     /** Return true if the peer is inactive and should be disconnected. */
     bool InactivityCheck(const CNode& node) const;
-    bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
-    void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
-    void SocketHandler();
-    void ThreadSocketHandler();
+    /**
+     * State of one socket handler thread. Every peer is served by exactly one
+     * of these (see GetSocketShard()), which therefore alone reads from and
+     * receives into that peer's socket and buffers; this keeps per-peer
+     * message order. The first shard also accepts new connections and
+     * disconnects peers.
+     */
+    struct SocketShard {
+        explicit SocketShard(size_t index_in)
+            : index(index_in), thread_name(index == 0 ? "net" : strprintf("net.%u", index)) {}
+        ~SocketShard();
+
+        const size_t index;
+        const std::string thread_name;
+        std::thread thread;
+#ifdef USE_EPOLL
+        /** epoll instance the sockets of this shard's peers are registered with, or INVALID_SOCKET. */
+        SOCKET epoll_fd{INVALID_SOCKET};
+        /**
+         * Peers registered with epoll_fd, by id. epoll events carry the peer's
+         * id, so an event for a peer that has been deleted in the meantime is
+         * simply not found here.
+         */
+        Mutex cs_nodes;
+        std::unordered_map<NodeId, CNode*> nodes GUARDED_BY(cs_nodes);
+        /**
+         * Edge-triggered events that were reported for a peer but not fully
+         * consumed yet. Each entry holds a reference to its peer. Only
+         * accessed by this shard's thread (and once it has stopped).
+         */
+        std::unordered_map<CNode*, uint32_t> events;
+        /** Next time this shard's peers are checked for inactivity. */
+        int64_t next_inactivity_check{0};
+#endif
+    };
+
+    /** (Re)create the socket handler shards. Must not be called while peers are connected. */
+    void InitSocketShards(int count);
+    SocketShard& GetSocketShard(const CNode& node) const;
+    bool IsPrimarySocketShard(const SocketShard& shard) const { return &shard == m_socket_shards.front().get(); }
+
+    bool GenerateSelectSet(const SocketShard& shard, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    void SocketEvents(const SocketShard& shard, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    void SocketHandler(SocketShard& shard);
+    /**
+     * Read once from a peer's socket and hand any completed messages to the
+     * message handler.
+     * @return true if the socket may have more data ready to be read.
+     */
+    bool SocketRecvData(CNode& node);
+    /** Whether socket events are waited for with epoll rather than SocketEvents(). */
+    bool UseEpoll() const;
+    /** Start receiving epoll events for a peer's socket (no-op without epoll). */
+    void RegisterNodeSocket(CNode& node);
+    /**
+     * Re-arm a peer's socket with epoll after a send left data queued, so an
+     * EPOLLOUT event follows as soon as it is writable, even if it already is
+     * again (no-op without epoll).
+     */
+    void RearmSendEvent(CNode& node);
+    /**
+     * Stop serving a peer's socket if nothing holds a reference to it anymore.
+     * @return true if the peer can be deleted.
+     */
+    bool UnregisterNodeSocket(CNode& node);
+#ifdef USE_EPOLL
+    void RegisterListenSockets();
+    /**
+     * Like SocketHandler(), but only touches the peers whose sockets the
+     * kernel reported as ready, keeping the GenerateSelectSet() rules: a
+     * peer with queued sends is not read from until its send queue has been
+     * drained, and a peer whose receive is paused is not read from at all.
+     */
+    void EpollSocketHandler(SocketShard& shard);
+    /** Whether the pending epoll events of a peer can be acted on right now. */
+    bool IsSocketActionable(CNode& node, uint32_t events) const;
+#endif
+    void ThreadSocketHandler(SocketShard& shard);
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -1056,6 +1183,9 @@ private:
     unsigned int nSendBufferMaxSize{0};
     unsigned int nReceiveFloodSize{0};
 
+    bool m_use_epoll{true};
+    std::vector<std::unique_ptr<SocketShard>> m_socket_shards;
+
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
@@ -1162,7 +1292,6 @@ private:
     std::unique_ptr<i2p::sam::Session> m_i2p_sam_session;
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockcache.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <net.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <streams.h>
+#include <version.h>
+
+#include <vector>
+
+void SerializedBlockCache::SetMaxSize(size_t max_bytes)
+{
+    LOCK(m_mutex);
+    m_max_bytes = max_bytes;
+    EvictToSize(m_max_bytes);
+}
+
+std::shared_ptr<const SharedNetPayload> SerializedBlockCache::Get(const uint256& hash, bool witness)
+{
+    LOCK(m_mutex);
+    const auto it = m_index.find(Key{hash, witness});
+    if (it == m_index.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->block;
+}
+
+void SerializedBlockCache::Insert(const uint256& hash, bool witness, std::shared_ptr<const SharedNetPayload> block)
+{
+    const size_t size = block->Bytes().size();
+    LOCK(m_mutex);
+    if (size > m_max_bytes) return;
+    const Key key{hash, witness};
+    if (m_index.count(key)) return;
+    EvictToSize(m_max_bytes - size);
+    m_lru.push_front(Entry{key, std::move(block), size});
+    m_index.emplace(key, m_lru.begin());
+    m_bytes += size;
+}
+
+void SerializedBlockCache::EvictToSize(size_t max_bytes)
+{
+    while (m_bytes > max_bytes) {
+        const Entry& entry = m_lru.back();
+        m_bytes -= entry.size;
+        m_index.erase(entry.key);
+        m_lru.pop_back();
+    }
+}
+
+SerializedBlockCache::Stats SerializedBlockCache::GetStats() const
+{
+    LOCK(m_mutex);
+    Stats stats;
+    stats.entries = m_lru.size();
+    stats.bytes = m_bytes;
+    stats.max_bytes = m_max_bytes;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    return stats;
+}
+
+std::shared_ptr<const SharedNetPayload> GetSerializedBlock(SerializedBlockCache& cache, const CBlockIndex* pindex, bool witness, const CChainParams& chainparams, const CBlock* block)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    if (auto cached = cache.Get(hash, witness)) return cached;
+
+    std::vector<uint8_t> data;
+    const int version = PROTOCOL_VERSION | (witness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS);
+    if (block) {
+        CVectorWriter{SER_NETWORK, version, data, 0, *block};
+    } else if (witness) {
+        // The witness serialization is the format on disk
+        if (!ReadRawBlockFromDisk(data, pindex, chainparams.MessageStart())) return nullptr;
+    } else {
+        CBlock block_read;
+        if (!ReadBlockFromDisk(block_read, pindex, chainparams.GetConsensus())) return nullptr;
+        CVectorWriter{SER_NETWORK, version, data, 0, block_read};
+    }
+    auto serialized = std::make_shared<const SharedNetPayload>(std::move(data));
+    cache.Insert(hash, witness, serialized);
+    return serialized;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOINDX_NODE_BLOCKCACHE_H
+#define BITCOINDX_NODE_BLOCKCACHE_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+class CBlock;
+class CBlockIndex;
+class CChainParams;
+class SharedNetPayload;
+
+/** Default for -blockcachesize, the size in MiB of the serialized block cache */
+static constexpr int64_t DEFAULT_BLOCK_CACHE_SIZE{32};
+
+/**
+ * Size-bounded LRU cache of serialized blocks, kept separately in the form
+ * with and without witness data. Blocks are immutable once stored, so entries
+ * never have to be invalidated, only evicted.
+ */
+class SerializedBlockCache
+{
+public:
+    struct Stats {
+        size_t entries{0};
+        size_t bytes{0};
+        size_t max_bytes{0};
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+    SerializedBlockCache() = default;
+    explicit SerializedBlockCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    /** Set the total size of the cached blocks to stay below; 0 disables the cache. */
+    void SetMaxSize(size_t max_bytes) LOCKS_EXCLUDED(m_mutex);
+
+    /** Look up a block, counting a hit or a miss. Returns nullptr if it is not cached. */
+    std::shared_ptr<const SharedNetPayload> Get(const uint256& hash, bool witness) LOCKS_EXCLUDED(m_mutex);
+
+    /** Add a block, evicting the least recently used ones to make room for it. */
+    void Insert(const uint256& hash, bool witness, std::shared_ptr<const SharedNetPayload> block) LOCKS_EXCLUDED(m_mutex);
+
+    Stats GetStats() const LOCKS_EXCLUDED(m_mutex);
+
+private:
+    using Key = std::pair<uint256, bool>;
+    struct KeyHasher {
+        size_t operator()(const Key& key) const { return BlockHasher{}(key.first) + key.second; }
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<const SharedNetPayload> block;
+        size_t size;
+    };
+
+    void EvictToSize(size_t max_bytes) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    size_t m_max_bytes GUARDED_BY(m_mutex){DEFAULT_BLOCK_CACHE_SIZE << 20};
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+    /** Cached blocks, most recently used first */
+    std::list<Entry> m_lru GUARDED_BY(m_mutex);
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> m_index GUARDED_BY(m_mutex);
+};
+
+/**
+ * Return a block in serialized form, with or without witness data. Taken from
+ * the cache if present, otherwise serialized from `block` if given or read
+ * from disk, and added to the cache. Returns nullptr if the block could not
+ * be read.
+ */
+std::shared_ptr<const SharedNetPayload> GetSerializedBlock(SerializedBlockCache& cache, const CBlockIndex* pindex, bool witness, const CChainParams& chainparams, const CBlock* block = nullptr);
+
+#endif // BITCOINDX_NODE_BLOCKCACHE_H
@@ -8,6 +8,7 @@
 #include <chainparams.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <flatfile.h>
 #include <fs.h>
 #include <hash.h>
@@ -15,10 +16,17 @@
 #include <shutdown.h>
 #include <signet.h>
 #include <streams.h>
+#include <sync.h>
 #include <undo.h>
 #include <util/system.h>
+#include <util/thread.h>
+#include <util/time.h>
 #include <validation.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fHavePruned = false;
@@ -453,7 +461,21 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
         block_pos = pindex->GetBlockPos();
     }
 
-    return ReadRawBlockFromDisk(block, block_pos, message_start);
+    if (!ReadRawBlockFromDisk(block, block_pos, message_start)) {
+        return false;
+    }
+    // Check the header against the index without deserializing the transactions
+    CBlockHeader header;
+    try {
+        VectorReader{SER_DISK, CLIENT_VERSION, block, 0} >> header;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), block_pos.ToString());
+    }
+    if (header.GetHash() != pindex->GetBlockHash()) {
+        return error("ReadRawBlockFromDisk(std::vector<uint8_t>&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+                     pindex->ToString(), block_pos.ToString());
+    }
+    return true;
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
@@ -491,33 +513,218 @@ struct CImportingNow {
     }
 };
 
+namespace {
+/**
+ * Reads a list of block files on a few threads, ahead of the import thread, which
+ * takes the blocks in file order. Each reader thread scans one file at a time. To
+ * bound memory, the readers only parse another block while the memory used by the
+ * parsed blocks waiting for the import is below the budget. The reader of the file
+ * being imported may also go on while none of its blocks are waiting, so it can't
+ * be starved by the others. Each reader can pass the check with one block, so the
+ * readers use at most the budget plus one block each.
+ */
+class BlockFileReader
+{
+public:
+    struct File {
+        fs::path path;
+        //! Number of the blk?????.dat file, or -1 for an external file
+        int num;
+    };
+
+    BlockFileReader(std::vector<File> files, const CChainParams& chainparams, int threads)
+        : m_params{chainparams},
+          m_budget{size_t(threads) * IMPORT_BUFFER_PER_THREAD},
+          m_start_time{GetTimeMillis()}
+    {
+        for (File& file : files) m_files.emplace_back(std::move(file));
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&util::TraceThread, "loadblkrd", [this] { ThreadRead(); });
+        }
+    }
+
+    ~BlockFileReader()
+    {
+        WITH_LOCK(m_mutex, m_interrupt = true);
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) thread.join();
+    }
+
+    /**
+     * Move on to the next file, dropping what is left of the current one.
+     * @returns the next file, or nullptr if there are none left.
+     */
+    const File* NextFile() LOCKS_EXCLUDED(m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_started && m_current < m_files.size()) {
+            ClearFile(m_files[m_current]);
+            ++m_current;
+        }
+        m_started = true;
+        m_cond.notify_all();
+        return m_current < m_files.size() ? &m_files[m_current].file : nullptr;
+    }
+
+    //! Whether the current file could be opened. Waits for its reader if needed.
+    bool Opened() LOCKS_EXCLUDED(m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        FileState& current = m_files[m_current];
+        m_cond.wait(lock, [&] { return current.started || m_interrupt; });
+        return current.opened;
+    }
+
+    //! Take the next block of the current file. Returns false at its end.
+    bool Next(ExternalBlock& block) LOCKS_EXCLUDED(m_mutex)
+    {
+        int64_t start = GetTimeMillis();
+        WAIT_LOCK(m_mutex, lock);
+        FileState& current = m_files[m_current];
+        m_cond.wait(lock, [&] { return !current.blocks.empty() || current.done || m_interrupt; });
+        m_wait_time += GetTimeMillis() - start;
+        if (current.blocks.empty()) return false;
+        block = std::move(current.blocks.front().block);
+        current.usage -= current.blocks.front().usage;
+        m_buffered -= current.blocks.front().usage;
+        current.blocks.pop_front();
+        m_cond.notify_all();
+        return true;
+    }
+
+    void LogTimes(const char* what) LOCKS_EXCLUDED(m_mutex)
+    {
+        LOCK(m_mutex);
+        LogPrintf("%s %u block files in %dms; reading them on %u threads took %dms, and the import waited %dms for them\n",
+                  what, m_files.size(), GetTimeMillis() - m_start_time, m_threads.size(), m_read_end_time - m_start_time, m_wait_time);
+    }
+
+private:
+    struct BufferedBlock {
+        ExternalBlock block;
+        //! Memory used by the parsed block
+        size_t usage;
+    };
+
+    struct FileState {
+        explicit FileState(File&& f) : file{std::move(f)} {}
+        const File file;
+        std::deque<BufferedBlock> blocks;
+        //! Memory used by blocks
+        size_t usage{0};
+        bool started{false};
+        bool opened{false};
+        bool done{false};
+    };
+
+    void ClearFile(FileState& state) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        m_buffered -= state.usage;
+        state.usage = 0;
+        state.blocks.clear();
+        m_cond.notify_all();
+    }
+
+    void ThreadRead() LOCKS_EXCLUDED(m_mutex)
+    {
+        while (true) {
+            size_t index;
+            {
+                LOCK(m_mutex);
+                if (m_interrupt || m_next_read == m_files.size()) return;
+                index = m_next_read++;
+            }
+            // m_files doesn't change size, so this stays valid
+            FileState& state = WITH_LOCK(m_mutex, return m_files[index]);
+
+            FILE* file = fsbridge::fopen(state.file.path, "rb");
+            WITH_LOCK(m_mutex, state.started = true; state.opened = file != nullptr);
+            m_cond.notify_all();
+            if (file) {
+                BlockFileScanner scanner(file, m_params, state.file.num);
+                while (true) {
+                    {
+                        WAIT_LOCK(m_mutex, lock);
+                        m_cond.wait(lock, [&] {
+                            return m_interrupt || index < m_current || m_buffered < m_budget || (index == m_current && state.blocks.empty());
+                        });
+                        // Skip the rest of a file the import is done with
+                        if (m_interrupt || index < m_current) break;
+                    }
+                    BufferedBlock buffered;
+                    if (!scanner.Next(buffered.block)) break;
+                    buffered.usage = RecursiveDynamicUsage(buffered.block.block);
+                    LOCK(m_mutex);
+                    if (index < m_current) break;
+                    state.usage += buffered.usage;
+                    m_buffered += buffered.usage;
+                    state.blocks.push_back(std::move(buffered));
+                    m_cond.notify_all();
+                }
+            }
+            {
+                LOCK(m_mutex);
+                state.done = true;
+                m_read_end_time = GetTimeMillis();
+            }
+            m_cond.notify_all();
+        }
+    }
+
+    const CChainParams& m_params;
+    //! Memory the parsed blocks read ahead of the import may use, see the class description
+    const size_t m_budget;
+    const int64_t m_start_time;
+    std::vector<std::thread> m_threads;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<FileState> m_files GUARDED_BY(m_mutex);
+    //! Index of the file being imported, once NextFile was called
+    size_t m_current GUARDED_BY(m_mutex){0};
+    bool m_started GUARDED_BY(m_mutex){false};
+    //! Index of the next file a reader thread should take
+    size_t m_next_read GUARDED_BY(m_mutex){0};
+    //! Memory used by blocks read but not imported yet, over all files
+    size_t m_buffered GUARDED_BY(m_mutex){0};
+    bool m_interrupt GUARDED_BY(m_mutex){false};
+    int64_t m_read_end_time GUARDED_BY(m_mutex){0};
+    int64_t m_wait_time GUARDED_BY(m_mutex){0};
+};
+} // namespace
+
 void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFiles, const ArgsManager& args)
 {
     ScheduleBatchPriority();
 
+    const int threads{std::clamp<int>(args.GetArg("-importthreads", DEFAULT_IMPORT_THREADS), 1, MAX_IMPORT_THREADS)};
     {
         CImportingNow imp;
 
         // -reindex
         if (fReindex) {
-            int nFile = 0;
-            while (true) {
-                FlatFilePos pos(nFile, 0);
-                if (!fs::exists(GetBlockPosFilename(pos))) {
+            std::vector<BlockFileReader::File> files;
+            for (int nFile = 0;; ++nFile) {
+                const fs::path path{GetBlockPosFilename(FlatFilePos(nFile, 0))};
+                if (!fs::exists(path)) {
                     break; // No block files left to reindex
                 }
-                FILE* file = OpenBlockFile(pos, true);
-                if (!file) {
-                    break; // This error is logged in OpenBlockFile
+                files.push_back({path, nFile});
+            }
+            BlockFileReader reader(std::move(files), Params(), threads);
+            while (const BlockFileReader::File* file = reader.NextFile()) {
+                if (!reader.Opened()) {
+                    LogPrintf("Unable to open file %s\n", file->path.string());
+                    break;
                 }
-                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-                chainman.ActiveChainstate().LoadExternalBlockFile(file, &pos);
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)file->num);
+                chainman.ActiveChainstate().LoadExternalBlocks([&reader](ExternalBlock& block) { return reader.Next(block); }, true);
                 if (ShutdownRequested()) {
                     LogPrintf("Shutdown requested. Exit %s\n", __func__);
                     return;
                 }
-                nFile++;
             }
+            reader.LogTimes("Reindexed");
             pblocktree->WriteReindexing(false);
             fReindex = false;
             LogPrintf("Reindexing finished\n");
@@ -526,18 +733,23 @@ void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFile
         }
 
         // -loadblock=
-        for (const fs::path& path : vImportFiles) {
-            FILE* file = fsbridge::fopen(path, "rb");
-            if (file) {
-                LogPrintf("Importing blocks file %s...\n", path.string());
-                chainman.ActiveChainstate().LoadExternalBlockFile(file);
-                if (ShutdownRequested()) {
-                    LogPrintf("Shutdown requested. Exit %s\n", __func__);
-                    return;
+        if (!vImportFiles.empty()) {
+            std::vector<BlockFileReader::File> files;
+            for (const fs::path& path : vImportFiles) files.push_back({path, -1});
+            BlockFileReader reader(std::move(files), Params(), threads);
+            while (const BlockFileReader::File* file = reader.NextFile()) {
+                if (reader.Opened()) {
+                    LogPrintf("Importing blocks file %s...\n", file->path.string());
+                    chainman.ActiveChainstate().LoadExternalBlocks([&reader](ExternalBlock& block) { return reader.Next(block); }, false);
+                    if (ShutdownRequested()) {
+                        LogPrintf("Shutdown requested. Exit %s\n", __func__);
+                        return;
+                    }
+                } else {
+                    LogPrintf("Warning: Could not open blocks file %s\n", file->path.string());
                 }
-            } else {
-                LogPrintf("Warning: Could not open blocks file %s\n", path.string());
             }
+            reader.LogTimes("Imported");
         }
 
         // scan for better chains in the block chain database, that are not yet connected in the active best chain
@@ -545,6 +757,7 @@ void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFile
         // We can't hold cs_main during ActivateBestChain even though we're accessing
         // the chainman unique_ptrs since ABC requires us not to be holding cs_main, so retrieve
         // the relevant pointers before the ABC call.
+        const int64_t connect_start{GetTimeMillis()};
         for (CChainState* chainstate : WITH_LOCK(::cs_main, return chainman.GetAll())) {
             BlockValidationState state;
             if (!chainstate->ActivateBestChain(state, nullptr)) {
@@ -553,6 +766,7 @@ void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFile
                 return;
             }
         }
+        LogPrintf("Connected the best chain after importing blocks in %dms\n", GetTimeMillis() - connect_start);
 
         if (args.GetBoolArg("-stopafterblockimport", DEFAULT_STOPAFTERBLOCKIMPORT)) {
             LogPrintf("Stopping after block import\n");
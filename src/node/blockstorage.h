@@ -27,6 +27,12 @@ struct Params;
 }
 
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT{false};
+/** Default for -importthreads, the number of threads reading block files during -reindex and -loadblock */
+static constexpr int DEFAULT_IMPORT_THREADS{2};
+/** Maximum for -importthreads */
+static constexpr int MAX_IMPORT_THREADS{8};
+/** Memory of parsed blocks that -reindex and -loadblock may read ahead, per -importthreads thread */
+static constexpr size_t IMPORT_BUFFER_PER_THREAD{128 << 20};
 
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
@@ -70,6 +76,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
+/** Read a block in its serialization on disk (with witness data), checking its header against the index */
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
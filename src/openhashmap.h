@@ -0,0 +1,425 @@
+// Copyright (c) 2021-2022 The Bitcoin DX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOINDX_OPENHASHMAP_H
+#define BITCOINDX_OPENHASHMAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash map with an open-addressing table, meant as a drop-in replacement for
+ * std::unordered_map where lookups dominate and many small entries are kept.
+ *
+ * The table is a flat array of node pointers, accompanied by an array of
+ * control bytes that hold 7 bits of each key's hash. Lookups probe linearly
+ * through the control bytes, which are contiguous in memory, and only
+ * dereference a node when its hash bits match. Nodes are not allocated
+ * individually but carved out of chunks of NODES_PER_CHUNK nodes, and erased
+ * nodes are recycled through a free list, so that there is neither a per-entry
+ * heap allocation nor a per-entry allocator overhead.
+ *
+ * Like std::unordered_map (and unlike most open-addressing maps), references to
+ * elements stay valid until the element is erased, as rehashing the table only
+ * moves node pointers. Iterators are invalidated by any insertion that
+ * rehashes the table, which happens when it grows and also when it is rebuilt
+ * at the same size to drop the tombstones left by erased elements. Erasing an
+ * element does not invalidate iterators to other elements, so erasing while
+ * iterating is supported.
+ *
+ * Memory held by erased nodes is only returned when the map is cleared. Maps
+ * that are cleared and refilled repeatedly can share a ChunkPool, which keeps
+ * the chunks of a cleared map around for the next map that needs nodes.
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class OpenHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+private:
+    union Node {
+        value_type value;
+        Node* next_free;
+        Node() : next_free(nullptr) {}
+        ~Node() {}
+    };
+
+    //! Control byte of a bucket that never held an element. Terminates probing.
+    static constexpr int8_t CTRL_EMPTY = -128;
+    //! Control byte of a bucket whose element was erased. Probing continues past it.
+    static constexpr int8_t CTRL_DELETED = -2;
+
+    //! Minimum number of buckets allocated once the map holds an element.
+    static constexpr size_t MIN_BUCKETS = 16;
+
+public:
+    //! Number of nodes allocated at once.
+    static constexpr size_t NODES_PER_CHUNK = 64;
+    //! Size of an allocated chunk of nodes, in bytes.
+    static constexpr size_t CHUNK_BYTES = sizeof(Node) * NODES_PER_CHUNK;
+
+    /**
+     * Chunks of nodes given back by cleared or destroyed maps, to be handed out
+     * to the maps using this pool instead of being freed and allocated again.
+     * At most max_chunks chunks are kept, any further ones are freed.
+     *
+     * Not thread-safe: all maps using a pool must be accessed under the same
+     * lock, and the pool must outlive them.
+     */
+    class ChunkPool
+    {
+        friend class OpenHashMap;
+
+        std::vector<std::unique_ptr<Node[]>> m_chunks;
+        const size_t m_max_chunks;
+
+    public:
+        explicit ChunkPool(size_t max_chunks) : m_max_chunks(max_chunks) {}
+        ChunkPool(const ChunkPool&) = delete;
+        ChunkPool& operator=(const ChunkPool&) = delete;
+
+        size_t chunk_count() const noexcept { return m_chunks.size(); }
+        size_t max_chunks() const noexcept { return m_max_chunks; }
+        //! Free all chunks held by the pool.
+        void clear() noexcept { m_chunks.clear(); }
+    };
+
+    template <bool is_const>
+    class Iterator
+    {
+        friend class OpenHashMap;
+        template <bool>
+        friend class Iterator;
+        using Map = std::conditional_t<is_const, const OpenHashMap, OpenHashMap>;
+
+        Map* m_map{nullptr};
+        size_t m_bucket{0};
+
+        Iterator(Map* map, size_t bucket) : m_map(map), m_bucket(bucket) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = OpenHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+        using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+
+        Iterator() = default;
+        //! Allow converting an iterator into a const_iterator.
+        template <bool other_const, typename = std::enable_if_t<is_const && !other_const>>
+        Iterator(const Iterator<other_const>& other) : m_map(other.m_map), m_bucket(other.m_bucket) {}
+
+        reference operator*() const { return m_map->m_buckets[m_bucket]->value; }
+        pointer operator->() const { return &m_map->m_buckets[m_bucket]->value; }
+
+        Iterator& operator++()
+        {
+            m_bucket = m_map->NextOccupied(m_bucket + 1);
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.m_bucket == b.m_bucket; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_bucket != b.m_bucket; }
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    OpenHashMap() = default;
+    //! Construct a map that takes its node chunks from pool and returns them there when cleared.
+    explicit OpenHashMap(ChunkPool* pool) : m_pool(pool) {}
+    OpenHashMap(const OpenHashMap&) = delete;
+    OpenHashMap& operator=(const OpenHashMap&) = delete;
+
+    OpenHashMap(OpenHashMap&& other) noexcept { MoveFrom(other); }
+    OpenHashMap& operator=(OpenHashMap&& other) noexcept
+    {
+        if (this != &other) {
+            clear();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    ~OpenHashMap() { clear(); }
+
+    iterator begin() noexcept { return iterator(this, NextOccupied(0)); }
+    const_iterator begin() const noexcept { return const_iterator(this, NextOccupied(0)); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(this, m_bucket_count); }
+    const_iterator end() const noexcept { return const_iterator(this, m_bucket_count); }
+    const_iterator cend() const noexcept { return end(); }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t bucket_count() const noexcept { return m_bucket_count; }
+    size_t chunk_count() const noexcept { return m_chunks.size(); }
+    //! Number of chunk pointers the chunk list has room for without reallocating.
+    size_t chunk_capacity() const noexcept { return m_chunks.capacity(); }
+    ChunkPool* chunk_pool() const noexcept { return m_pool; }
+
+    iterator find(const Key& key) { return iterator(this, FindBucket(key, (*m_hasher)(key))); }
+    const_iterator find(const Key& key) const { return const_iterator(this, FindBucket(key, (*m_hasher)(key))); }
+    size_t count(const Key& key) const { return FindBucket(key, (*m_hasher)(key)) != m_bucket_count; }
+
+    /** Insert an element constructed from (key, args...) if the key is not present yet. */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        const size_t hash{(*m_hasher)(key)};
+        const size_t found{FindBucket(key, hash)};
+        if (found != m_bucket_count) return {iterator(this, found), false};
+
+        Node* node = AllocateNode();
+        try {
+            ::new (&node->value) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        } catch (...) {
+            ReleaseNode(node);
+            throw;
+        }
+        return {iterator(this, InsertNode(node, hash)), true};
+    }
+
+    /** Construct an element from args, and insert it if its key is not present yet. */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        Node* node = AllocateNode();
+        try {
+            ::new (&node->value) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            ReleaseNode(node);
+            throw;
+        }
+        const size_t hash{(*m_hasher)(node->value.first)};
+        const size_t found{FindBucket(node->value.first, hash)};
+        if (found != m_bucket_count) {
+            node->value.~value_type();
+            ReleaseNode(node);
+            return {iterator(this, found), false};
+        }
+        return {iterator(this, InsertNode(node, hash)), true};
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) { return emplace(std::move(value)); }
+    std::pair<iterator, bool> insert(const value_type& value) { return emplace(value); }
+
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    /** Erase the element pointed to by pos, and return an iterator to the next element. */
+    iterator erase(const_iterator pos)
+    {
+        const size_t bucket{pos.m_bucket};
+        assert(bucket < m_bucket_count && m_ctrl[bucket] >= 0);
+        Node* node = m_buckets[bucket];
+        node->value.~value_type();
+        ReleaseNode(node);
+        m_buckets[bucket] = nullptr;
+        // A bucket followed by an empty one is not part of any other key's probe
+        // sequence, so it can be marked empty instead of leaving a tombstone.
+        if (m_ctrl[(bucket + 1) & (m_bucket_count - 1)] == CTRL_EMPTY) {
+            m_ctrl[bucket] = CTRL_EMPTY;
+        } else {
+            m_ctrl[bucket] = CTRL_DELETED;
+            ++m_deleted;
+        }
+        --m_size;
+        return iterator(this, NextOccupied(bucket + 1));
+    }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    size_t erase(const Key& key)
+    {
+        const size_t bucket{FindBucket(key, (*m_hasher)(key))};
+        if (bucket == m_bucket_count) return 0;
+        erase(const_iterator(this, bucket));
+        return 1;
+    }
+
+    /**
+     * Destroy all elements and release their nodes, a whole chunk at a time.
+     * Chunks go back to the pool if there is one and it has room, and are freed
+     * otherwise. The table itself is kept.
+     */
+    void clear() noexcept
+    {
+        for (size_t i = 0; i < m_bucket_count; ++i) {
+            if (m_ctrl[i] >= 0) m_buckets[i]->value.~value_type();
+            m_ctrl[i] = CTRL_EMPTY;
+            m_buckets[i] = nullptr;
+        }
+        if (m_pool) {
+            for (auto& chunk : m_chunks) {
+                if (m_pool->m_chunks.size() >= m_pool->m_max_chunks) break;
+                m_pool->m_chunks.push_back(std::move(chunk));
+            }
+        }
+        m_chunks.clear();
+        m_chunk_used = NODES_PER_CHUNK;
+        m_free = nullptr;
+        m_size = 0;
+        m_deleted = 0;
+    }
+
+    /** Make room for count elements without growing the table. */
+    void reserve(size_t count)
+    {
+        size_t buckets{MIN_BUCKETS};
+        while (!WithinLoadFactor(count, buckets)) buckets *= 2;
+        if (buckets > m_bucket_count) Rehash(buckets);
+    }
+
+private:
+    std::unique_ptr<Node*[]> m_buckets;
+    std::unique_ptr<int8_t[]> m_ctrl;
+    //! Number of buckets; always zero or a power of two.
+    size_t m_bucket_count{0};
+    //! Number of elements.
+    size_t m_size{0};
+    //! Number of tombstones (CTRL_DELETED control bytes) in the table.
+    size_t m_deleted{0};
+
+    std::vector<std::unique_ptr<Node[]>> m_chunks;
+    //! Number of nodes of the last chunk that were handed out.
+    size_t m_chunk_used{NODES_PER_CHUNK};
+    //! Singly linked list of released nodes.
+    Node* m_free{nullptr};
+    //! Where chunks are taken from and returned to, if any.
+    ChunkPool* m_pool{nullptr};
+
+    //! Held in an optional so a moved-to map can take over the hasher along with the buckets,
+    //! as salted hashers are not assignable.
+    std::optional<Hash> m_hasher{std::in_place};
+    KeyEqual m_key_equal;
+
+    //! Keep at most 7 out of 8 buckets in use (including tombstones).
+    static bool WithinLoadFactor(size_t used, size_t buckets) { return used * 8 <= buckets * 7; }
+
+    //! The hash bits stored in the control byte; never negative.
+    static int8_t HashTag(size_t hash) { return static_cast<int8_t>(hash >> (std::numeric_limits<size_t>::digits - 7)); }
+
+    size_t NextOccupied(size_t bucket) const
+    {
+        while (bucket < m_bucket_count && m_ctrl[bucket] < 0) ++bucket;
+        return bucket;
+    }
+
+    //! Return the bucket holding key, or m_bucket_count if it is not present.
+    size_t FindBucket(const Key& key, size_t hash) const
+    {
+        if (m_bucket_count == 0) return 0;
+        const size_t mask{m_bucket_count - 1};
+        const int8_t tag{HashTag(hash)};
+        for (size_t bucket = hash & mask;; bucket = (bucket + 1) & mask) {
+            const int8_t ctrl{m_ctrl[bucket]};
+            if (ctrl == CTRL_EMPTY) return m_bucket_count;
+            if (ctrl == tag && m_key_equal(m_buckets[bucket]->value.first, key)) return bucket;
+        }
+    }
+
+    //! Place a node whose key is not present in the table, growing it if needed.
+    size_t InsertNode(Node* node, size_t hash)
+    {
+        if (!WithinLoadFactor(m_size + m_deleted + 1, m_bucket_count)) {
+            // Only grow when live elements need the room, otherwise just drop the tombstones.
+            Rehash(WithinLoadFactor(2 * (m_size + 1), m_bucket_count) ? m_bucket_count : std::max(MIN_BUCKETS, 2 * m_bucket_count));
+        }
+        const size_t mask{m_bucket_count - 1};
+        size_t bucket{hash & mask};
+        while (m_ctrl[bucket] >= 0) bucket = (bucket + 1) & mask;
+        if (m_ctrl[bucket] == CTRL_DELETED) --m_deleted;
+        m_ctrl[bucket] = HashTag(hash);
+        m_buckets[bucket] = node;
+        ++m_size;
+        return bucket;
+    }
+
+    void Rehash(size_t bucket_count)
+    {
+        auto buckets = std::make_unique<Node*[]>(bucket_count);
+        auto ctrl = std::make_unique<int8_t[]>(bucket_count);
+        std::fill_n(ctrl.get(), bucket_count, CTRL_EMPTY);
+        const size_t mask{bucket_count - 1};
+        for (size_t i = 0; i < m_bucket_count; ++i) {
+            if (m_ctrl[i] < 0) continue;
+            const size_t hash{(*m_hasher)(m_buckets[i]->value.first)};
+            size_t bucket{hash & mask};
+            while (ctrl[bucket] >= 0) bucket = (bucket + 1) & mask;
+            ctrl[bucket] = HashTag(hash);
+            buckets[bucket] = m_buckets[i];
+        }
+        m_buckets = std::move(buckets);
+        m_ctrl = std::move(ctrl);
+        m_bucket_count = bucket_count;
+        m_deleted = 0;
+    }
+
+    Node* AllocateNode()
+    {
+        if (m_free) {
+            Node* node = m_free;
+            m_free = node->next_free;
+            return node;
+        }
+        if (m_chunk_used == NODES_PER_CHUNK) {
+            if (m_pool && !m_pool->m_chunks.empty()) {
+                m_chunks.push_back(std::move(m_pool->m_chunks.back()));
+                m_pool->m_chunks.pop_back();
+            } else {
+                m_chunks.push_back(std::make_unique<Node[]>(NODES_PER_CHUNK));
+            }
+            m_chunk_used = 0;
+        }
+        return &m_chunks.back()[m_chunk_used++];
+    }
+
+    void ReleaseNode(Node* node) noexcept
+    {
+        node->next_free = m_free;
+        m_free = node;
+    }
+
+    void MoveFrom(OpenHashMap& other) noexcept
+    {
+        m_buckets = std::move(other.m_buckets);
+        m_ctrl = std::move(other.m_ctrl);
+        m_bucket_count = std::exchange(other.m_bucket_count, 0);
+        m_size = std::exchange(other.m_size, 0);
+        m_deleted = std::exchange(other.m_deleted, 0);
+        m_chunks = std::move(other.m_chunks);
+        other.m_chunks.clear();
+        m_chunk_used = std::exchange(other.m_chunk_used, NODES_PER_CHUNK);
+        m_free = std::exchange(other.m_free, nullptr);
+        m_pool = other.m_pool;
+        m_hasher.emplace(*other.m_hasher);
+    }
+};
+
+#endif // BITCOINDX_OPENHASHMAP_H
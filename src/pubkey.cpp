@@ -194,6 +194,120 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_verify, sigbytes.data(), msg.begin(), &pubkey);
 }
 
+void SchnorrBatch::Add(const XOnlyPubKey& pubkey, const uint256& msg, Span<const unsigned char> sigbytes)
+{
+    assert(sigbytes.size() == 64);
+    Entry& entry = m_entries.emplace_back();
+    entry.pubkey = pubkey;
+    entry.msg = msg;
+    std::copy(sigbytes.begin(), sigbytes.end(), entry.sig.begin());
+}
+
+static const CHashWriter HASHER_BIP340_CHALLENGE = TaggedHash("BIP0340/challenge");
+static const CHashWriter HASHER_BIP340_BATCH = TaggedHash("BIP0340/batch");
+
+bool SchnorrBatch::Verify() const
+{
+    // The public secp256k1 API has no multi-multiplication, so adding a signature's R_i and P_i
+    // to the sum below costs two multiplications, more than verifying it on its own does. What
+    // the batch saves is the multiplication by the key for every signature but one of a key, so
+    // signatures by a key that signs nothing else in the batch are verified on their own.
+    std::vector<const Entry*> sorted(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); ++i) sorted[i] = &m_entries[i];
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->pubkey < b->pubkey; });
+    std::vector<const Entry*> batched;
+    for (size_t i = 0; i < sorted.size();) {
+        size_t end = i + 1;
+        while (end < sorted.size() && sorted[end]->pubkey == sorted[i]->pubkey) ++end;
+        if (end - i == 1) {
+            if (!sorted[i]->pubkey.VerifySchnorr(sorted[i]->msg, sorted[i]->sig)) return false;
+        } else {
+            batched.insert(batched.end(), sorted.begin() + i, sorted.begin() + end);
+        }
+        i = end;
+    }
+    if (batched.empty()) return true;
+
+    // Check that the sum of s_i * G over the batched signatures, each multiplied by a randomizer
+    // a_i, equals the sum of a_i * R_i + a_i * e_i * P_i. The randomizers are derived from the
+    // whole batch, so they can't be known before the signatures are chosen. 128 bits of them
+    // make a forgery pass with negligible probability, and halve the cost of multiplying R_i.
+    // a_0 is 1, and R_0 is left out of the sum to be compared with the rest.
+    CHashWriter batch_hasher{HASHER_BIP340_BATCH};
+    for (const Entry* entry : batched) {
+        batch_hasher << Span<const unsigned char>(entry->pubkey.data(), 32) << entry->msg << Span<const unsigned char>(entry->sig);
+    }
+    const uint256 batch_hash{batch_hasher.GetSHA256()};
+
+    // The terms to add up: a_i * R_i for all but the first signature, and for every key the sum
+    // of a_i * e_i over its signatures, multiplied by the key.
+    std::vector<secp256k1_pubkey> terms;
+    terms.reserve(batched.size() - 1 + batched.size() / 2);
+    unsigned char r_first[33];
+    // The sum of a_i * s_i
+    unsigned char s_sum[32];
+    // The sum of a_i * e_i for the current key
+    uint256 p_factor;
+    for (size_t i = 0; i < batched.size(); ++i) {
+        const Entry& entry = *batched[i];
+        const uint256 challenge{(CHashWriter(HASHER_BIP340_CHALLENGE) << Span<const unsigned char>(entry.sig).first(32) << Span<const unsigned char>(entry.pubkey.data(), 32) << entry.msg).GetSHA256()};
+        // Scalars are big-endian, so a_0 = 1 is a last byte of 1.
+        uint256 randomizer;
+        if (i > 0) {
+            const uint256 hash{(CHashWriter(SER_GETHASH, 0) << batch_hash << uint64_t{i}).GetSHA256()};
+            std::copy(hash.begin(), hash.begin() + 16, randomizer.begin() + 16);
+        } else {
+            *(randomizer.end() - 1) = 1;
+        }
+
+        // R_i and P_i are the points with even y for the given x coordinates.
+        unsigned char point[33] = {SECP256K1_TAG_PUBKEY_EVEN};
+        std::copy(entry.sig.begin(), entry.sig.begin() + 32, point + 1);
+        if (i == 0) {
+            std::copy(point, point + 33, r_first);
+        } else {
+            secp256k1_pubkey& r_term = terms.emplace_back();
+            if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &r_term, point, sizeof(point))) return false;
+            if (!secp256k1_ec_pubkey_tweak_mul(secp256k1_context_verify, &r_term, randomizer.begin())) return false;
+        }
+
+        uint256 factor{randomizer};
+        if (!secp256k1_ec_seckey_tweak_mul(secp256k1_context_verify, factor.begin(), challenge.begin())) return false;
+        if (i == 0 || entry.pubkey != batched[i - 1]->pubkey) {
+            p_factor = factor;
+        } else if (!secp256k1_ec_seckey_tweak_add(secp256k1_context_verify, p_factor.begin(), factor.begin())) {
+            return false;
+        }
+        if (i + 1 == batched.size() || entry.pubkey != batched[i + 1]->pubkey) {
+            std::copy(entry.pubkey.begin(), entry.pubkey.end(), point + 1);
+            secp256k1_pubkey& p_term = terms.emplace_back();
+            if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &p_term, point, sizeof(point))) return false;
+            if (!secp256k1_ec_pubkey_tweak_mul(secp256k1_context_verify, &p_term, p_factor.begin())) return false;
+        }
+
+        // Fails if s_i is not below the group order, as it then doesn't verify on its own either.
+        if (i == 0) {
+            std::copy(entry.sig.begin() + 32, entry.sig.end(), s_sum);
+            if (!secp256k1_ec_seckey_verify(secp256k1_context_verify, s_sum)) return false;
+        } else {
+            if (!secp256k1_ec_seckey_tweak_mul(secp256k1_context_verify, randomizer.begin(), entry.sig.data() + 32)) return false;
+            if (!secp256k1_ec_seckey_tweak_add(secp256k1_context_verify, s_sum, randomizer.begin())) return false;
+        }
+    }
+
+    // R_0 must equal s_sum * G minus all the other terms.
+    std::vector<const secp256k1_pubkey*> term_ptrs(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) term_ptrs[i] = &terms[i];
+    secp256k1_pubkey sum;
+    if (!secp256k1_ec_pubkey_combine(secp256k1_context_verify, &sum, term_ptrs.data(), term_ptrs.size())) return false;
+    if (!secp256k1_ec_pubkey_negate(secp256k1_context_verify, &sum)) return false;
+    if (!secp256k1_ec_pubkey_tweak_add(secp256k1_context_verify, &sum, s_sum)) return false;
+    unsigned char r_expected[33];
+    size_t r_expected_size = sizeof(r_expected);
+    secp256k1_ec_pubkey_serialize(secp256k1_context_verify, r_expected, &r_expected_size, &sum, SECP256K1_EC_COMPRESSED);
+    return std::equal(r_expected, r_expected + r_expected_size, r_first);
+}
+
 static const CHashWriter HASHER_TAPTWEAK = TaggedHash("TapTweak");
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -279,6 +280,33 @@ public:
     bool operator<(const XOnlyPubKey& other) const { return m_keydata < other.m_keydata; }
 };
 
+/** A set of Schnorr signatures to be verified together, which doesn't tell which
+ *  signature is invalid. Signatures by a key that signs more than one of them are
+ *  checked in a single equation, multiplying the key once, which is faster than
+ *  verifying them one by one. The others are verified one by one. */
+class SchnorrBatch
+{
+private:
+    struct Entry {
+        XOnlyPubKey pubkey;
+        uint256 msg;
+        std::array<unsigned char, 64> sig;
+    };
+    std::vector<Entry> m_entries;
+
+public:
+    /** Add a signature to the batch. sigbytes must be exactly 64 bytes. */
+    void Add(const XOnlyPubKey& pubkey, const uint256& msg, Span<const unsigned char> sigbytes);
+
+    /** Verify all signatures in the batch. Returns true if they are all valid, or
+     *  if the batch is empty. */
+    bool Verify() const;
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    void clear() { m_entries.clear(); }
+};
+
 struct CExtPubKey {
     unsigned char nDepth;
     unsigned char vchFingerprint[4];
@@ -8,11 +8,14 @@
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <net.h>
+#include <node/blockcache.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <streams.h>
@@ -24,12 +27,23 @@
 #include <version.h>
 
 #include <any>
+#include <chrono>
 
 #include <boost/algorithm/string.hpp>
 
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+//! Maximum number of outpoints that can be queried at once when sent as binary post data
+static const size_t MAX_GETUTXOS_BATCH_OUTPOINTS = 10000;
+//! Maximum number of headers returned by /rest/headers/
+static const long MAX_REST_HEADERS_RESULTS = 100000;
+//! Maximum number of blocks returned by /rest/blocks/
+static const long MAX_REST_BLOCKS_RESULTS = 10000;
+//! Size above which a reply is sent as a chunked reply while it is being produced
+static const size_t REST_STREAM_FLUSH_SIZE = 1 << 16;
+//! Time after which a streamed reply is cut short, so one request can't hold an HTTP worker thread indefinitely
+static constexpr std::chrono::seconds MAX_REST_STREAM_TIME{300};
 
 enum class RetFormat {
     UNDEF,
@@ -69,6 +83,89 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string me
     return false;
 }
 
+/**
+ * Reply body that is produced piece by piece. Small bodies are sent as one
+ * reply; once more than REST_STREAM_FLUSH_SIZE bytes are buffered the reply
+ * continues as a chunked reply, so large bodies are never held in memory as
+ * a whole. A reply that is not done after MAX_REST_STREAM_TIME, however fast
+ * the client reads, ends there.
+ */
+class RESTStreamedReply
+{
+public:
+    RESTStreamedReply(HTTPRequest* req, std::string content_type)
+        : m_req(req), m_content_type(std::move(content_type)),
+          m_deadline(std::chrono::steady_clock::now() + MAX_REST_STREAM_TIME) {}
+
+    /** Append to the body. Returns false if the client has gone away or the time is up. */
+    bool Write(const std::string& data)
+    {
+        m_buffer += data;
+        if (m_buffer.size() >= REST_STREAM_FLUSH_SIZE) return Flush();
+        return !Closed();
+    }
+
+    /** Whether no more of the body is wanted, as the client has gone away or the time is up. */
+    bool Closed()
+    {
+        if (!m_closed && m_chunked && std::chrono::steady_clock::now() > m_deadline) {
+            LogPrintf("REST: %s took longer than %d seconds, truncating the reply\n", m_req->GetURI(), count_seconds(MAX_REST_STREAM_TIME));
+            m_closed = true;
+        }
+        return m_closed;
+    }
+
+    /** Whether nothing was sent yet, so that an error reply can still be sent instead. */
+    bool CanFail() const { return !m_chunked; }
+
+    /** Send the rest of the body and complete the reply. */
+    void Finish()
+    {
+        if (m_chunked) {
+            Flush();
+            m_req->EndChunkedReply();
+        } else {
+            m_req->WriteHeader("Content-Type", m_content_type);
+            m_req->WriteReply(HTTP_OK, m_buffer);
+        }
+    }
+
+private:
+    bool Flush()
+    {
+        if (!m_chunked) {
+            m_req->WriteHeader("Content-Type", m_content_type);
+            m_req->StartChunkedReply(HTTP_OK);
+            m_chunked = true;
+        }
+        if (!m_buffer.empty() && !Closed() && !m_req->WriteReplyChunk(m_buffer, m_deadline)) {
+            // Logs the truncation if the wait ran into the deadline
+            Closed();
+            m_closed = true;
+        }
+        m_buffer.clear();
+        return !m_closed;
+    }
+
+    HTTPRequest* const m_req;
+    const std::string m_content_type;
+    const std::chrono::steady_clock::time_point m_deadline;
+    std::string m_buffer;
+    bool m_chunked{false};
+    bool m_closed{false};
+};
+
+static const char* FormatContentType(RetFormat rf)
+{
+    switch (rf) {
+    case RetFormat::BINARY: return "application/octet-stream";
+    case RetFormat::HEX: return "text/plain";
+    case RetFormat::JSON: return "application/json";
+    case RetFormat::UNDEF: break;
+    }
+    assert(false);
+}
+
 /**
  * Get the node context.
  *
@@ -190,7 +287,7 @@ static bool rest_headers(const std::any& context,
         return RESTERR(req, HTTP_BAD_REQUEST, "No header count specified. Use /rest/headers/<count>/<hash>.<ext>.");
 
     long count = strtol(path[0].c_str(), nullptr, 10);
-    if (count < 1 || count > 2000)
+    if (count < 1 || count > MAX_REST_HEADERS_RESULTS)
         return RESTERR(req, HTTP_BAD_REQUEST, "Header count out of range: " + path[0]);
 
     std::string hashStr = path[1];
@@ -218,37 +315,29 @@ static bool rest_headers(const std::any& context,
     }
 
     switch (rf) {
-    case RetFormat::BINARY: {
-        CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-        for (const CBlockIndex *pindex : headers) {
-            ssHeader << pindex->GetBlockHeader();
-        }
-
-        std::string binaryHeader = ssHeader.str();
-        req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryHeader);
-        return true;
-    }
-
+    case RetFormat::BINARY:
     case RetFormat::HEX: {
-        CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+        RESTStreamedReply reply(req, FormatContentType(rf));
         for (const CBlockIndex *pindex : headers) {
+            CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
             ssHeader << pindex->GetBlockHeader();
+            if (!reply.Write(rf == RetFormat::BINARY ? ssHeader.str() : HexStr(ssHeader))) break;
         }
-
-        std::string strHex = HexStr(ssHeader) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
+        if (rf == RetFormat::HEX) reply.Write("\n");
+        reply.Finish();
         return true;
     }
     case RetFormat::JSON: {
-        UniValue jsonHeaders(UniValue::VARR);
+        RESTStreamedReply reply(req, FormatContentType(rf));
+        JSONStreamWriter writer([&reply](std::string data) { reply.Write(data); }, REST_STREAM_FLUSH_SIZE);
+        writer.BeginArray();
         for (const CBlockIndex *pindex : headers) {
-            jsonHeaders.push_back(blockheaderToJSON(tip, pindex));
+            if (reply.Closed()) break;
+            writer.Value(blockheaderToJSON(tip, pindex));
         }
-        std::string strJSON = jsonHeaders.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        writer.EndArray();
+        reply.Write(writer.TakeBuffer() + "\n");
+        reply.Finish();
         return true;
     }
     default: {
@@ -257,6 +346,96 @@ static bool rest_headers(const std::any& context,
     }
 }
 
+static bool rest_blocks(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (rf == RetFormat::UNDEF) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/blocks/<height>/<count>.<ext>.");
+
+    int32_t start_height = -1;
+    if (!ParseInt32(path[0], &start_height) || start_height < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+
+    int32_t count = 0;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > MAX_REST_BLOCKS_RESULTS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + SanitizeString(path[1]));
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    const CBlockIndex* tip = nullptr;
+    std::vector<const CBlockIndex*> blocks;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = maybe_chainman->ActiveChain();
+        tip = active_chain.Tip();
+        if (start_height > active_chain.Height()) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        }
+        const int32_t end_height = std::min<int64_t>(int64_t{start_height} + count - 1, active_chain.Height());
+        blocks.reserve(end_height - start_height + 1);
+        for (int32_t height = start_height; height <= end_height; ++height) {
+            const CBlockIndex* pindex = active_chain[height];
+            if (IsBlockPruned(pindex)) {
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            }
+            blocks.push_back(pindex);
+        }
+    }
+
+    // Read the blocks one at a time without going through the block cache, as
+    // a long range would only evict the blocks that peers are asking for
+    const CChainParams& chainparams = Params();
+    const bool witness = !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+    RESTStreamedReply reply(req, FormatContentType(rf));
+    JSONStreamWriter writer([&reply](std::string data) { reply.Write(data); }, REST_STREAM_FLUSH_SIZE);
+    if (rf == RetFormat::JSON) writer.BeginArray();
+    for (const CBlockIndex* pindex : blocks) {
+        if (reply.Closed()) break;
+        std::vector<uint8_t> raw_block;
+        CBlock block;
+        bool read;
+        if (rf != RetFormat::JSON && witness) {
+            read = ReadRawBlockFromDisk(raw_block, pindex, chainparams.MessageStart());
+        } else {
+            read = ReadBlockFromDisk(block, pindex, chainparams.GetConsensus());
+        }
+        if (!read) {
+            if (reply.CanFail()) {
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            }
+            // The status was sent already, so the best that can be done is to
+            // end the reply early
+            LogPrintf("REST: could not read block %s, truncating the reply\n", pindex->GetBlockHash().GetHex());
+            break;
+        }
+        if (rf == RetFormat::JSON) {
+            blockToJSON(writer, block, tip, pindex, true);
+            continue;
+        }
+        if (!witness) {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+            ssBlock << block;
+            raw_block.assign(ssBlock.begin(), ssBlock.end());
+        }
+        reply.Write(rf == RetFormat::BINARY ? std::string(raw_block.begin(), raw_block.end()) : HexStr(raw_block) + "\n");
+    }
+    if (rf == RetFormat::JSON) {
+        writer.EndArray();
+        reply.Write(writer.TakeBuffer() + "\n");
+    }
+    reply.Finish();
+    return true;
+}
+
 static bool rest_block(const std::any& context,
                        HTTPRequest* req,
                        const std::string& strURIPart,
@@ -272,6 +451,7 @@ static bool rest_block(const std::any& context,
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
     CBlock block;
+    std::shared_ptr<const SharedNetPayload> serialized_block;
     CBlockIndex* pblockindex = nullptr;
     CBlockIndex* tip = nullptr;
     {
@@ -288,24 +468,27 @@ static bool rest_block(const std::any& context,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (rf == RetFormat::BINARY || rf == RetFormat::HEX) {
+            // Serialized replies share the block cache with P2P block serving
+            const bool witness = !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+            serialized_block = GetSerializedBlock(chainman.m_blockman.m_block_cache, pblockindex, witness, Params());
+            if (!serialized_block)
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        } else if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
     }
 
     switch (rf) {
     case RetFormat::BINARY: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string binaryBlock = ssBlock.str();
+        const Span<const unsigned char> binaryBlock = serialized_block->Bytes();
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
+        req->WriteReply(HTTP_OK, std::string(binaryBlock.begin(), binaryBlock.end()));
         return true;
     }
 
     case RetFormat::HEX: {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock) + "\n";
+        std::string strHex = HexStr(serialized_block->Bytes()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
@@ -535,8 +718,7 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
                 if (fInputParsed) //don't allow sending input over URI and HTTP RAW DATA
                     return RESTERR(req, HTTP_BAD_REQUEST, "Combination of URI scheme inputs and raw post data is not allowed");
 
-                CDataStream oss(SER_NETWORK, PROTOCOL_VERSION);
-                oss << strRequestMutable;
+                CDataStream oss(MakeUCharSpan(strRequestMutable), SER_NETWORK, PROTOCOL_VERSION);
                 oss >> fCheckMemPool;
                 oss >> vOutPoints;
             }
@@ -557,9 +739,10 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
     }
     }
 
-    // limit max outpoints
-    if (vOutPoints.size() > MAX_GETUTXOS_OUTPOINTS)
-        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_GETUTXOS_OUTPOINTS, vOutPoints.size()));
+    // limit max outpoints, allowing larger batches as post data than in the URI
+    const size_t max_outpoints = fInputParsed ? MAX_GETUTXOS_OUTPOINTS : MAX_GETUTXOS_BATCH_OUTPOINTS;
+    if (vOutPoints.size() > max_outpoints)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", max_outpoints, vOutPoints.size()));
 
     // check spentness and form a bitmap (as well as a JSON capable human-readable string representation)
     std::vector<unsigned char> bitmap;
@@ -567,11 +750,18 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
     std::string bitmapStringRepresentation;
     std::vector<bool> hits;
     bitmap.resize((vOutPoints.size() + 7) / 8);
+    outs.reserve(vOutPoints.size());
+    hits.reserve(vOutPoints.size());
     ChainstateManager* maybe_chainman = GetChainman(context, req);
     if (!maybe_chainman) return false;
     ChainstateManager& chainman = *maybe_chainman;
+    int chain_height;
+    uint256 chain_tip_hash;
     {
-        auto process_utxos = [&vOutPoints, &outs, &hits](const CCoinsView& view, const CTxMemPool& mempool) {
+        auto process_utxos = [&](const CCoinsView& view, const CTxMemPool& mempool) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+            // Report the chain state the lookups were made against
+            chain_height = chainman.ActiveChain().Height();
+            chain_tip_hash = chainman.ActiveChain().Tip()->GetBlockHash();
             for (const COutPoint& vOutPoint : vOutPoints) {
                 Coin coin;
                 bool hit = !mempool.isSpent(vOutPoint) && view.GetCoin(vOutPoint, coin);
@@ -605,7 +795,7 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
         // serialize data
         // use exact same output as mentioned in Bip64
         CDataStream ssGetUTXOResponse(SER_NETWORK, PROTOCOL_VERSION);
-        ssGetUTXOResponse << chainman.ActiveChain().Height() << chainman.ActiveChain().Tip()->GetBlockHash() << bitmap << outs;
+        ssGetUTXOResponse << chain_height << chain_tip_hash << bitmap << outs;
         std::string ssGetUTXOResponseString = ssGetUTXOResponse.str();
 
         req->WriteHeader("Content-Type", "application/octet-stream");
@@ -615,7 +805,7 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
 
     case RetFormat::HEX: {
         CDataStream ssGetUTXOResponse(SER_NETWORK, PROTOCOL_VERSION);
-        ssGetUTXOResponse << chainman.ActiveChain().Height() << chainman.ActiveChain().Tip()->GetBlockHash() << bitmap << outs;
+        ssGetUTXOResponse << chain_height << chain_tip_hash << bitmap << outs;
         std::string strHex = HexStr(ssGetUTXOResponse) + "\n";
 
         req->WriteHeader("Content-Type", "text/plain");
@@ -628,8 +818,8 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
 
         // pack in some essentials
         // use more or less the same output as mentioned in Bip64
-        objGetUTXOResponse.pushKV("chainHeight", chainman.ActiveChain().Height());
-        objGetUTXOResponse.pushKV("chaintipHash", chainman.ActiveChain().Tip()->GetBlockHash().GetHex());
+        objGetUTXOResponse.pushKV("chainHeight", chain_height);
+        objGetUTXOResponse.pushKV("chaintipHash", chain_tip_hash.GetHex());
         objGetUTXOResponse.pushKV("bitmap", bitmapStringRepresentation);
 
         UniValue utxos(UniValue::VARR);
@@ -719,6 +909,7 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blocks/", rest_blocks},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
 };
@@ -18,6 +18,8 @@
 #include <hash.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <net.h>
+#include <node/blockcache.h>
 #include <node/blockstorage.h>
 #include <node/coinstats.h>
 #include <node/context.h>
@@ -27,6 +29,7 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
@@ -199,14 +202,20 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+/** The fields of a block's JSON description other than its transactions */
+static UniValue blockSummaryToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex)
 {
     UniValue result = blockheaderToJSON(tip, blockindex);
 
     result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
     result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
     result.pushKV("weight", (int)::GetBlockWeight(block));
-    UniValue txs(UniValue::VARR);
+    return result;
+}
+
+/** Pass the JSON description of each transaction in a block, or only its txid, to fn */
+static void ForEachBlockTxToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const std::function<void(const UniValue&)>& fn)
+{
     if (txDetails) {
         CBlockUndo blockUndo;
         const bool have_undo = !IsBlockPruned(blockindex) && UndoReadFromDisk(blockUndo, blockindex);
@@ -216,18 +225,37 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
             const CTxUndo* txundo = (have_undo && i) ? &blockUndo.vtxundo.at(i - 1) : nullptr;
             UniValue objTx(UniValue::VOBJ);
             TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags(), txundo);
-            txs.push_back(objTx);
+            fn(objTx);
         }
     } else {
         for (const CTransactionRef& tx : block.vtx) {
-            txs.push_back(tx->GetHash().GetHex());
+            fn(tx->GetHash().GetHex());
         }
     }
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    UniValue result = blockSummaryToJSON(block, tip, blockindex);
+
+    UniValue txs(UniValue::VARR);
+    ForEachBlockTxToJSON(block, blockindex, txDetails, [&](const UniValue& tx) { txs.push_back(tx); });
     result.pushKV("tx", txs);
 
     return result;
 }
 
+void blockToJSON(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    writer.BeginObject();
+    writer.Members(blockSummaryToJSON(block, tip, blockindex));
+    writer.Key("tx");
+    writer.BeginArray();
+    ForEachBlockTxToJSON(block, blockindex, txDetails, [&](const UniValue& tx) { writer.Value(tx); });
+    writer.EndArray();
+    writer.EndObject();
+}
+
 static RPCHelpMan getblockcount()
 {
     return RPCHelpMan{"getblockcount",
@@ -542,6 +570,36 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("unbroadcast", pool.IsUnbroadcastTx(tx.GetHash()));
 }
 
+void MempoolToJSON(JSONStreamWriter& writer, const CTxMemPool& pool)
+{
+    // Writing blocks while a slow client catches up, so pool.cs is not held then. The result
+    // covers the transactions in the mempool at the start, less those that left it since. They
+    // are described a batch at a time.
+    static constexpr size_t BATCH_SIZE{1000};
+    std::vector<uint256> txids;
+    WITH_LOCK(pool.cs, pool.queryHashes(txids));
+    std::vector<std::pair<std::string, UniValue>> batch;
+    writer.BeginObject();
+    for (size_t start = 0; start < txids.size(); start += BATCH_SIZE) {
+        {
+            LOCK(pool.cs);
+            for (size_t i = start; i < std::min(start + BATCH_SIZE, txids.size()); ++i) {
+                const auto it = pool.GetIter(txids[i]);
+                if (!it) continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, **it);
+                batch.emplace_back(txids[i].ToString(), std::move(info));
+            }
+        }
+        for (const auto& [txid, info] : batch) {
+            writer.Key(txid);
+            writer.Value(info);
+        }
+        batch.clear();
+    }
+    writer.EndObject();
+}
+
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
 {
     if (verbose) {
@@ -628,6 +686,10 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (fVerbose && !include_mempool_sequence && request.result_stream) {
+        MempoolToJSON(*request.result_stream, EnsureAnyMemPool(request.context));
+        return NullUniValue;
+    }
     return MempoolToJSON(EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
@@ -885,8 +947,7 @@ static RPCHelpMan getblockheader()
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << pblockindex->GetBlockHeader();
-        std::string strHex = HexStr(ssBlock);
-        return strHex;
+        return SerializedResult(request, MakeUCharSpan(ssBlock));
     }
 
     return blockheaderToJSON(tip, pblockindex);
@@ -911,6 +972,21 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
     return block;
 }
 
+static std::shared_ptr<const SharedNetPayload> GetSerializedBlockChecked(BlockManager& blockman, const CBlockIndex* pblockindex)
+{
+    if (IsBlockPruned(pblockindex)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
+
+    const bool witness = !(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS);
+    std::shared_ptr<const SharedNetPayload> block = GetSerializedBlock(blockman.m_block_cache, pblockindex, witness, Params());
+    if (!block) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    }
+
+    return block;
+}
+
 static CBlockUndo GetUndoChecked(const CBlockIndex* pblockindex)
 {
     CBlockUndo blockUndo;
@@ -994,6 +1070,7 @@ static RPCHelpMan getblock()
     }
 
     CBlock block;
+    std::shared_ptr<const SharedNetPayload> serialized_block;
     const CBlockIndex* pblockindex;
     const CBlockIndex* tip;
     {
@@ -1006,17 +1083,21 @@ static RPCHelpMan getblock()
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         }
 
-        block = GetBlockChecked(pblockindex);
+        if (verbosity <= 0) {
+            serialized_block = GetSerializedBlockChecked(chainman.m_blockman, pblockindex);
+        } else {
+            block = GetBlockChecked(pblockindex);
+        }
     }
 
-    if (verbosity <= 0)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock);
-        return strHex;
+    if (serialized_block) {
+        return SerializedResult(request, serialized_block->Bytes());
     }
 
+    if (request.result_stream) {
+        blockToJSON(*request.result_stream, block, tip, pblockindex, verbosity >= 2);
+        return NullUniValue;
+    }
     return blockToJSON(block, tip, pblockindex, verbosity >= 2);
 },
     };
@@ -0,0 +1,103 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <cassert>
+#include <utility>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_size)
+    : m_sink(std::move(sink)), m_flush_size(flush_size)
+{
+}
+
+void JSONStreamWriter::Separator()
+{
+    if (m_after_key) {
+        m_after_key = false;
+    } else if (!m_need_comma.empty()) {
+        if (m_need_comma.back()) m_buffer += ',';
+        m_need_comma.back() = true;
+    }
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() >= m_flush_size) Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separator();
+    m_buffer += '{';
+    m_need_comma.push_back(false);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_need_comma.empty() && !m_after_key);
+    m_need_comma.pop_back();
+    m_buffer += '}';
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separator();
+    m_buffer += '[';
+    m_need_comma.push_back(false);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_need_comma.empty() && !m_after_key);
+    m_need_comma.pop_back();
+    m_buffer += ']';
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_need_comma.empty() && !m_after_key);
+    Separator();
+    // Let UniValue take care of the escaping
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separator();
+    m_buffer += value.write();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Members(const UniValue& object)
+{
+    assert(object.isObject());
+    const std::vector<std::string>& keys = object.getKeys();
+    const std::vector<UniValue>& values = object.getValues();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Key(keys[i]);
+        Value(values[i]);
+    }
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_flushed = true;
+    m_sink(TakeBuffer());
+}
+
+std::string JSONStreamWriter::TakeBuffer()
+{
+    std::string data;
+    data.reserve(m_flush_size);
+    std::swap(data, m_buffer);
+    return data;
+}
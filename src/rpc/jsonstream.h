@@ -0,0 +1,74 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOINDX_RPC_JSONSTREAM_H
+#define BITCOINDX_RPC_JSONSTREAM_H
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/** Default number of bytes a JSONStreamWriter buffers before passing them on */
+static constexpr size_t DEFAULT_JSON_STREAM_FLUSH_SIZE{1 << 16};
+
+/** Thrown by the sink of a JSONStreamWriter once it takes no more output */
+class JSONStreamClosed : public std::runtime_error
+{
+public:
+    JSONStreamClosed() : std::runtime_error("Result stream closed") {}
+};
+
+/**
+ * Writes compact JSON incrementally, for results too large to build as one
+ * UniValue tree. Containers are opened and closed explicitly and their
+ * elements are written one by one, each of which may be a UniValue of its own.
+ * Output is passed to the sink whenever more than flush_size bytes are
+ * buffered. A sink that takes no more output, e.g. because the client went
+ * away, throws JSONStreamClosed, which stops the producer of the output.
+ *
+ * The caller is responsible for the structure: inside an object, every value
+ * must be preceded by a Key().
+ */
+class JSONStreamWriter
+{
+public:
+    using Sink = std::function<void(std::string)>;
+
+    explicit JSONStreamWriter(Sink sink, size_t flush_size = DEFAULT_JSON_STREAM_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    /** Write the key/value pairs of a UniValue object into the object being written. */
+    void Members(const UniValue& object);
+
+    /** Whether anything was written, whether passed to the sink yet or not. */
+    bool HasOutput() const { return m_flushed || !m_buffer.empty(); }
+    /** Pass all buffered output to the sink. */
+    void Flush();
+    /** Return the output not passed to the sink yet, leaving the buffer empty. */
+    std::string TakeBuffer();
+
+private:
+    void Separator();
+    void MaybeFlush();
+
+    const Sink m_sink;
+    const size_t m_flush_size;
+    std::string m_buffer;
+    bool m_flushed{false};
+    /** Per open container, whether the next element must be preceded by a comma */
+    std::vector<bool> m_need_comma;
+    /** Whether a key was written, the value of which comes next */
+    bool m_after_key{false};
+};
+
+#endif // BITCOINDX_RPC_JSONSTREAM_H
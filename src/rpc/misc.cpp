@@ -19,6 +19,7 @@
 #include <rpc/util.h>
 #include <scheduler.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <util/check.h>
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
@@ -455,6 +456,16 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCSignatureCacheInfo()
+{
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hits", stats.hits);
+    obj.pushKV("misses", stats.misses);
+    obj.pushKV("evictions", stats.evictions);
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -499,6 +510,12 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "sigcache", "Information about the signature cache",
+                            {
+                                {RPCResult::Type::NUM, "hits", "Number of lookups that found the signature"},
+                                {RPCResult::Type::NUM, "misses", "Number of lookups that did not find the signature"},
+                                {RPCResult::Type::NUM, "evictions", "Number of valid signatures dropped to make room for others"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -515,6 +532,7 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("sigcache", RPCSignatureCacheInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -8,11 +8,13 @@
 #include <chainparams.h>
 #include <clientversion.h>
 #include <core_io.h>
+#include <index/blockfilterindex.h>
 #include <net.h>
 #include <net_permissions.h>
 #include <net_processing.h>
 #include <net_types.h> // For banmap_t
 #include <netbase.h>
+#include <node/blockcache.h>
 #include <node/context.h>
 #include <policy/settings.h>
 #include <rpc/blockchain.h>
@@ -611,6 +613,36 @@ static RPCHelpMan getnetworkinfo()
                         }},
                         {RPCResult::Type::NUM, "relayfee", "minimum relay fee rate for transactions in " + CURRENCY_UNIT + "/kvB"},
                         {RPCResult::Type::NUM, "incrementalfee", "minimum fee rate increment for mempool limiting or BIP 125 replacement in " + CURRENCY_UNIT + "/kvB"},
+                        {RPCResult::Type::OBJ, "blockcache", "the cache of serialized blocks served to peers and REST clients",
+                        {
+                            {RPCResult::Type::NUM, "entries", "the number of cached blocks (counting the forms with and without witness data separately)"},
+                            {RPCResult::Type::NUM, "bytes", "the total size of the cached blocks"},
+                            {RPCResult::Type::NUM, "maxbytes", "the maximum total size of the cached blocks (-blockcachesize)"},
+                            {RPCResult::Type::NUM, "hits", "the number of blocks served from the cache"},
+                            {RPCResult::Type::NUM, "misses", "the number of blocks read from disk"},
+                            {RPCResult::Type::NUM, "hitrate", "the fraction of blocks served from the cache"},
+                        }},
+                        {RPCResult::Type::OBJ, "blockfiltercache", /* optional */ true, "the caches of the basic block filter index, only present if -blockfilterindex is enabled for it",
+                        {
+                            {RPCResult::Type::OBJ, "filters", "the cache of recently looked up filters",
+                            {
+                                {RPCResult::Type::NUM, "entries", "the number of cached filters"},
+                                {RPCResult::Type::NUM, "bytes", "the approximate memory used by the cached filters"},
+                                {RPCResult::Type::NUM, "maxbytes", "the maximum memory used by the cached filters (half of -blockfiltercachesize)"},
+                                {RPCResult::Type::NUM, "hits", "the number of filters served from the cache"},
+                                {RPCResult::Type::NUM, "misses", "the number of filters read from disk"},
+                                {RPCResult::Type::NUM, "hitrate", "the fraction of filters served from the cache"},
+                            }},
+                            {RPCResult::Type::OBJ, "headers", "the most recent part of the filter header chain kept in memory",
+                            {
+                                {RPCResult::Type::NUM, "entries", "the number of cached filter headers"},
+                                {RPCResult::Type::NUM, "bytes", "the approximate memory used by the cached filter headers"},
+                                {RPCResult::Type::NUM, "maxbytes", "the maximum memory used by the cached filter headers (half of -blockfiltercachesize)"},
+                                {RPCResult::Type::NUM, "hits", "the number of filter headers and hashes served from the header chain or the checkpoint cache"},
+                                {RPCResult::Type::NUM, "misses", "the number of filter headers and hashes looked up in the database"},
+                                {RPCResult::Type::NUM, "hitrate", "the fraction of filter headers and hashes served from the cache"},
+                            }},
+                        }},
                         {RPCResult::Type::ARR, "localaddresses", "list of local addresses",
                         {
                             {RPCResult::Type::OBJ, "", "",
@@ -653,6 +685,41 @@ static RPCHelpMan getnetworkinfo()
     obj.pushKV("networks",      GetNetworksInfo());
     obj.pushKV("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK()));
     obj.pushKV("incrementalfee", ValueFromAmount(::incrementalRelayFee.GetFeePerK()));
+    if (node.chainman) {
+        const SerializedBlockCache::Stats stats = node.chainman->m_blockman.m_block_cache.GetStats();
+        UniValue block_cache(UniValue::VOBJ);
+        block_cache.pushKV("entries", (uint64_t)stats.entries);
+        block_cache.pushKV("bytes", (uint64_t)stats.bytes);
+        block_cache.pushKV("maxbytes", (uint64_t)stats.max_bytes);
+        block_cache.pushKV("hits", stats.hits);
+        block_cache.pushKV("misses", stats.misses);
+        const uint64_t lookups = stats.hits + stats.misses;
+        block_cache.pushKV("hitrate", lookups ? double(stats.hits) / lookups : 0.0);
+        obj.pushKV("blockcache", block_cache);
+    }
+    if (const BlockFilterIndex* index = GetBlockFilterIndex(BlockFilterType::BASIC)) {
+        const BlockFilterIndex::CacheStats stats = index->GetCacheStats();
+        UniValue filters(UniValue::VOBJ);
+        filters.pushKV("entries", (uint64_t)stats.filter_entries);
+        filters.pushKV("bytes", (uint64_t)stats.filter_bytes);
+        filters.pushKV("maxbytes", (uint64_t)stats.filter_max_bytes);
+        filters.pushKV("hits", stats.filter_hits);
+        filters.pushKV("misses", stats.filter_misses);
+        const uint64_t filter_lookups = stats.filter_hits + stats.filter_misses;
+        filters.pushKV("hitrate", filter_lookups ? double(stats.filter_hits) / filter_lookups : 0.0);
+        UniValue headers(UniValue::VOBJ);
+        headers.pushKV("entries", (uint64_t)stats.header_entries);
+        headers.pushKV("bytes", (uint64_t)stats.header_bytes);
+        headers.pushKV("maxbytes", (uint64_t)stats.header_max_bytes);
+        headers.pushKV("hits", stats.header_hits);
+        headers.pushKV("misses", stats.header_misses);
+        const uint64_t header_lookups = stats.header_hits + stats.header_misses;
+        headers.pushKV("hitrate", header_lookups ? double(stats.header_hits) / header_lookups : 0.0);
+        UniValue filter_cache(UniValue::VOBJ);
+        filter_cache.pushKV("filters", filters);
+        filter_cache.pushKV("headers", headers);
+        obj.pushKV("blockfiltercache", filter_cache);
+    }
     UniValue localAddresses(UniValue::VARR);
     {
         LOCK(cs_mapLocalHost);
@@ -29,6 +29,7 @@
 #include <script/sign.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util/bip32.h>
 #include <util/moneystr.h>
@@ -36,6 +37,7 @@
 #include <util/string.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <version.h>
 
 #include <numeric>
 #include <stdint.h>
@@ -213,7 +215,9 @@ static RPCHelpMan getrawtransaction()
     }
 
     if (!fVerbose) {
-        return EncodeHexTx(*tx, RPCSerializationFlags());
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        ssTx << tx;
+        return SerializedResult(request, MakeUCharSpan(ssTx));
     }
 
     UniValue result(UniValue::VOBJ);
@@ -11,6 +11,8 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
+
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
@@ -36,6 +38,17 @@ public:
     std::string authUser;
     std::string peerAddr;
     std::any context;
+    /**
+     * If set, a handler may write a large result here as it is produced
+     * instead of returning it, in which case it returns NullUniValue.
+     */
+    JSONStreamWriter* result_stream = nullptr;
+    /**
+     * If set, a handler returning serialized data as a hex string puts the raw
+     * bytes here instead, in which case it returns NullUniValue. See
+     * SerializedResult().
+     */
+    std::vector<unsigned char>* raw_result = nullptr;
 
     void parse(const UniValue& valRequest);
 };
@@ -5,19 +5,27 @@
 
 #include <rpc/server.h>
 
+#include <httpserver.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/signals2/signal.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
 #include <memory> // for unique_ptr
 #include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_map>
 
 static Mutex g_rpc_warmup_mutex;
@@ -37,10 +45,18 @@ struct RPCCommandExecutionInfo
     int64_t start;
 };
 
+struct RPCMethodStats
+{
+    uint64_t calls{0};
+    int64_t total_duration{0};
+    int64_t max_duration{0};
+};
+
 struct RPCServerInfo
 {
     Mutex mutex;
     std::list<RPCCommandExecutionInfo> active_commands GUARDED_BY(mutex);
+    std::map<std::string, RPCMethodStats> method_stats GUARDED_BY(mutex);
 };
 
 static RPCServerInfo g_rpc_server_info;
@@ -56,6 +72,11 @@ struct RPCCommandExecution
     ~RPCCommandExecution()
     {
         LOCK(g_rpc_server_info.mutex);
+        const int64_t duration = GetTimeMicros() - it->start;
+        RPCMethodStats& stats = g_rpc_server_info.method_stats[it->method];
+        ++stats.calls;
+        stats.total_duration += duration;
+        stats.max_duration = std::max(stats.max_duration, duration);
         g_rpc_server_info.active_commands.erase(it);
     }
 };
@@ -220,6 +241,31 @@ static RPCHelpMan getrpcinfo()
                             }},
                         }},
                         {RPCResult::Type::STR, "logpath", "The complete file path to the debug log"},
+                        {RPCResult::Type::OBJ_DYN, "methods", "Statistics of the commands executed since startup",
+                        {
+                            {RPCResult::Type::OBJ, "method", "The name of the RPC command",
+                            {
+                                {RPCResult::Type::NUM, "calls", "The number of times the command was executed"},
+                                {RPCResult::Type::NUM, "total_duration", "The total running time in microseconds"},
+                                {RPCResult::Type::NUM, "max_duration", "The longest running time in microseconds"},
+                            }},
+                        }},
+                        {RPCResult::Type::OBJ, "workqueue", /* optional */ true, "The HTTP work queue, if the HTTP server is running",
+                        {
+                            {RPCResult::Type::NUM, "depth", "The number of requests waiting to be handled"},
+                            {RPCResult::Type::NUM, "maxdepth", "The maximum number of requests waiting (-rpcworkqueue)"},
+                            {RPCResult::Type::NUM, "rejected", "The number of requests rejected because the queue was full"},
+                            {RPCResult::Type::ARR, "workers", "One entry per worker thread (-rpcthreads)",
+                            {
+                                {RPCResult::Type::OBJ, "", "",
+                                {
+                                    {RPCResult::Type::NUM, "requests", "The number of requests handled"},
+                                    {RPCResult::Type::NUM, "queue_wait", "The total time in microseconds these requests were queued"},
+                                    {RPCResult::Type::NUM, "max_queue_wait", "The longest time in microseconds a request was queued"},
+                                    {RPCResult::Type::NUM, "busy", "The total time in microseconds spent handling requests"},
+                                }},
+                            }},
+                        }},
                     }
                 },
                 RPCExamples{
@@ -243,6 +289,35 @@ static RPCHelpMan getrpcinfo()
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
 
+    UniValue methods(UniValue::VOBJ);
+    for (const auto& [method, stats] : g_rpc_server_info.method_stats) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("calls", stats.calls);
+        entry.pushKV("total_duration", stats.total_duration);
+        entry.pushKV("max_duration", stats.max_duration);
+        methods.pushKV(method, entry);
+    }
+    result.pushKV("methods", methods);
+
+    HTTPWorkQueueStats queue_stats;
+    if (GetHTTPWorkQueueStats(queue_stats)) {
+        UniValue workqueue(UniValue::VOBJ);
+        workqueue.pushKV("depth", (uint64_t)queue_stats.depth);
+        workqueue.pushKV("maxdepth", (uint64_t)queue_stats.max_depth);
+        workqueue.pushKV("rejected", queue_stats.rejected);
+        UniValue workers(UniValue::VARR);
+        for (const HTTPWorkQueueStats::Worker& worker : queue_stats.workers) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("requests", worker.requests);
+            entry.pushKV("queue_wait", worker.queue_wait);
+            entry.pushKV("max_queue_wait", worker.max_queue_wait);
+            entry.pushKV("busy", worker.busy);
+            workers.push_back(entry);
+        }
+        workqueue.pushKV("workers", workers);
+        result.pushKV("workqueue", workqueue);
+    }
+
     return result;
 }
     };
@@ -287,10 +362,86 @@ bool CRPCTable::removeCommand(const std::string& name, const CRPCCommand* pcmd)
     return false;
 }
 
+namespace {
+/** Threads helping to execute the entries of JSON-RPC batches (-rpcbatchthreads) */
+class BatchThreadPool
+{
+public:
+    void Start(int num_threads)
+    {
+        WITH_LOCK(m_mutex, m_stop = false);
+        for (int i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back([this, i] {
+                util::ThreadRename(strprintf("rpcbatch.%i", i));
+                Run();
+            });
+        }
+        m_num_threads = num_threads;
+    }
+
+    void Stop()
+    {
+        m_num_threads = 0;
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+            m_tasks.clear();
+        }
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+    int NumThreads() const { return m_num_threads; }
+
+    void Enqueue(std::function<void()> task)
+    {
+        {
+            LOCK(m_mutex);
+            if (m_stop) return;
+            m_tasks.push_back(std::move(task));
+        }
+        m_cond.notify_one();
+    }
+
+private:
+    void Run()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_tasks.empty(); });
+                if (m_stop) return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::function<void()>> m_tasks GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+    std::atomic<int> m_num_threads{0};
+};
+} // namespace
+
+static BatchThreadPool g_batch_thread_pool;
+
 void StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
     g_rpc_running = true;
+    const int batch_threads = std::clamp<int64_t>(gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 0, MAX_RPC_BATCH_THREADS);
+    if (batch_threads > 0) {
+        LogPrint(BCLog::RPC, "Starting %d RPC batch threads\n", batch_threads);
+        g_batch_thread_pool.Start(batch_threads);
+    }
     g_rpcSignals.Started();
 }
 
@@ -313,6 +464,8 @@ void StopRPC()
     std::call_once(g_rpc_stop_flag, []() {
         LogPrint(BCLog::RPC, "Stopping RPC\n");
         WITH_LOCK(g_deadline_timers_mutex, deadlineTimers.clear());
+        // Batches still being executed finish on their own threads
+        g_batch_thread_pool.Stop();
         DeleteAuthCookie();
         g_rpcSignals.Stopped();
     });
@@ -379,12 +532,100 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
+/**
+ * Methods that only read state, so that requests for them give the same
+ * results whether they are executed one after another or in parallel. Keep in
+ * sync with doc/JSON-RPC-interface.md.
+ */
+static const std::set<std::string> PARALLEL_BATCH_METHODS{
+    "decoderawtransaction",
+    "decodescript",
+    "deriveaddresses",
+    "estimatesmartfee",
+    "getbestblockhash",
+    "getblock",
+    "getblockchaininfo",
+    "getblockcount",
+    "getblockfilter",
+    "getblockhash",
+    "getblockheader",
+    "getblockstats",
+    "getchaintips",
+    "getdifficulty",
+    "getdescriptorinfo",
+    "getmempoolancestors",
+    "getmempooldescendants",
+    "getmempoolentry",
+    "getmempoolinfo",
+    "getrawmempool",
+    "getrawtransaction",
+    "gettxout",
+    "gettxoutproof",
+    "validateaddress",
+    "verifymessage",
+    "verifytxoutproof",
+};
+
+bool IsParallelBatchMethod(const std::string& method)
+{
+    return PARALLEL_BATCH_METHODS.count(method);
+}
+
+/** Entries [begin, end) of a batch, claimed one by one by the threads executing them */
+struct BatchRun {
+    std::atomic<size_t> next;
+    const size_t end;
+    Mutex mutex;
+    std::condition_variable cond;
+    size_t done GUARDED_BY(mutex){0};
+
+    BatchRun(size_t begin, size_t end_in) : next(begin), end(end_in) {}
+};
+
+static void ExecBatchRun(BatchRun& run, const JSONRPCRequest& jreq, const UniValue& vReq, std::vector<UniValue>& replies)
+{
+    for (size_t i = run.next++; i < run.end; i = run.next++) {
+        replies[i] = JSONRPCExecOne(jreq, vReq[i]);
+        WITH_LOCK(run.mutex, ++run.done);
+        run.cond.notify_all();
+    }
+}
+
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    std::vector<UniValue> replies(vReq.size());
+    const auto parallel = [&](size_t i) {
+        return vReq[i].isObject() && find_value(vReq[i], "method").isStr() && IsParallelBatchMethod(find_value(vReq[i], "method").get_str());
+    };
+    size_t begin = 0;
+    while (begin < vReq.size()) {
+        size_t end = begin + 1;
+        const int num_threads = g_batch_thread_pool.NumThreads();
+        if (num_threads > 0 && parallel(begin)) {
+            while (end < vReq.size() && parallel(end)) ++end;
+        }
+        if (end - begin == 1) {
+            replies[begin] = JSONRPCExecOne(jreq, vReq[begin]);
+        } else {
+            // This thread takes part as well, so the batch completes even if
+            // all pool threads are busy. Helpers that find no entries left
+            // return without touching the batch.
+            auto run = std::make_shared<BatchRun>(begin, end);
+            const size_t num_helpers = std::min<size_t>(num_threads, end - begin - 1);
+            for (size_t i = 0; i < num_helpers; ++i) {
+                g_batch_thread_pool.Enqueue([run, &jreq, &vReq, &replies] { ExecBatchRun(*run, jreq, vReq, replies); });
+            }
+            ExecBatchRun(*run, jreq, vReq, replies);
+            WAIT_LOCK(run->mutex, lock);
+            run->cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(run->mutex) { return run->done == end - begin; });
+        }
+        begin = end;
+    }
 
+    UniValue ret(UniValue::VARR);
+    for (const UniValue& reply : replies) {
+        ret.push_back(reply);
+    }
     return ret.write() + "\n";
 }
 
@@ -18,6 +18,10 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+/** Default for -rpcbatchthreads, the number of threads helping to execute the entries of a batch in parallel */
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
+/** Maximum for -rpcbatchthreads */
+static const int MAX_RPC_BATCH_THREADS = 64;
 
 class CRPCCommand;
 
@@ -173,7 +177,14 @@ extern CRPCTable tableRPC;
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
+/**
+ * Execute a batch of requests and return the replies, in the same order.
+ * Consecutive requests for methods that are safe to run in parallel are
+ * executed concurrently if -rpcbatchthreads is set.
+ */
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Whether requests for a method may be executed in parallel within a batch */
+bool IsParallelBatchMethod(const std::string& method);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
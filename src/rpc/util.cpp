@@ -4,6 +4,7 @@
 
 #include <key_io.h>
 #include <outputtype.h>
+#include <rpc/jsonstream.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
 #include <script/signingprovider.h>
@@ -113,6 +114,15 @@ std::vector<unsigned char> ParseHexO(const UniValue& o, std::string strKey)
     return ParseHexV(find_value(o, strKey), strKey);
 }
 
+UniValue SerializedResult(const JSONRPCRequest& request, Span<const unsigned char> data)
+{
+    if (request.raw_result) {
+        request.raw_result->assign(data.begin(), data.end());
+        return NullUniValue;
+    }
+    return HexStr(data);
+}
+
 namespace {
 
 /**
@@ -573,6 +583,14 @@ UniValue RPCHelpMan::HandleRequest(const JSONRPCRequest& request) const
         throw std::runtime_error(ToString());
     }
     const UniValue ret = m_fun(*this, request);
+    if (request.result_stream && request.result_stream->HasOutput()) {
+        // The result was written to the stream instead
+        return ret;
+    }
+    if (request.raw_result && !request.raw_result->empty()) {
+        // The result was passed on in binary form instead
+        return ret;
+    }
     CHECK_NONFATAL(std::any_of(m_results.m_results.begin(), m_results.m_results.end(), [ret](const RPCResult& res) { return res.MatchesType(ret); }));
     return ret;
 }
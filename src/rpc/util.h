@@ -16,6 +16,7 @@
 #include <script/sign.h>
 #include <script/standard.h>
 #include <univalue.h>
+#include <span.h>
 #include <util/check.h>
 
 #include <string>
@@ -77,6 +78,12 @@ uint256 ParseHashO(const UniValue& o, std::string strKey);
 std::vector<unsigned char> ParseHexV(const UniValue& v, std::string strName);
 std::vector<unsigned char> ParseHexO(const UniValue& o, std::string strKey);
 
+/**
+ * Return serialized data as a hex string, or, if the client asked for a binary
+ * reply (JSONRPCRequest::raw_result), pass on the raw bytes and return null.
+ */
+UniValue SerializedResult(const JSONRPCRequest& request, Span<const unsigned char> data);
+
 /**
  * Validate and return a CAmount from a UniValue number or string.
  *
@@ -5,16 +5,18 @@
 
 #include <script/sigcache.h>
 
+#include <clientversion.h>
+#include <logging.h>
+#include <policy/policy.h>
 #include <pubkey.h>
 #include <random.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util/system.h>
 
 #include <cuckoocache.h>
 
 #include <algorithm>
-#include <mutex>
-#include <shared_mutex>
 #include <vector>
 
 namespace {
@@ -29,26 +31,31 @@ private:
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    uint256 m_nonce;
+    typedef CuckooCache::sharded_cache<uint256, SignatureCacheHasher, SignatureCacheShardHasher, SIGNATURE_CACHE_SHARDS> map_type;
     map_type setValid;
-    std::shared_mutex cs_sigcache;
 
 public:
-    CSignatureCache()
+    //! Salt the entries with nonce. Entries computed with a previous nonce can no longer be found.
+    void SetNonce(const uint256& nonce)
     {
-        uint256 nonce = GetRandHash();
+        m_nonce = nonce;
         // We want the nonce to be 64 bytes long to force the hasher to process
         // this chunk, which makes later hash computations more efficient. We
         // just write our 32-byte entropy, and then pad with 'E' for ECDSA and
         // 'S' for Schnorr (followed by 0 bytes).
         static constexpr unsigned char PADDING_ECDSA[32] = {'E'};
         static constexpr unsigned char PADDING_SCHNORR[32] = {'S'};
+        m_salted_hasher_ecdsa = CSHA256();
         m_salted_hasher_ecdsa.Write(nonce.begin(), 32);
         m_salted_hasher_ecdsa.Write(PADDING_ECDSA, 32);
+        m_salted_hasher_schnorr = CSHA256();
         m_salted_hasher_schnorr.Write(nonce.begin(), 32);
         m_salted_hasher_schnorr.Write(PADDING_SCHNORR, 32);
     }
 
+    const uint256& GetNonce() const { return m_nonce; }
+
     void
     ComputeEntryECDSA(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
     {
@@ -66,19 +73,27 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
         return setValid.contains(entry, erase);
     }
 
     void Set(const uint256& entry)
     {
-        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
     uint32_t setup_bytes(size_t n)
     {
         return setValid.setup_bytes(n);
     }
+    map_type::stats GetStats() const
+    {
+        return setValid.get_stats();
+    }
+    std::vector<uint256> GetEntries() const
+    {
+        std::vector<uint256> entries;
+        setValid.for_each([&entries](const uint256& entry) { entries.push_back(entry); });
+        return entries;
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -94,6 +109,7 @@ static CSignatureCache signatureCache;
 // signatureCache.
 void InitSignatureCache()
 {
+    signatureCache.SetNonce(GetRandHash());
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
@@ -102,6 +118,103 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+SignatureCacheStats GetSignatureCacheStats()
+{
+    const auto stats = signatureCache.GetStats();
+    return {stats.hits, stats.misses, stats.evictions};
+}
+
+static const uint64_t SALTED_CACHE_DUMP_VERSION = 2;
+
+bool DumpSaltedCache(const fs::path& path, const uint256& nonce, const std::vector<uint256>& entries)
+{
+    fs::path path_new = path;
+    path_new += ".new";
+    try {
+        CAutoFile file(fsbridge::fopen(path_new, "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            return false;
+        }
+        file << SALTED_CACHE_DUMP_VERSION;
+        file << int{CLIENT_VERSION};
+        file << STANDARD_SCRIPT_VERIFY_FLAGS;
+        file << nonce;
+        file << entries;
+        if (!FileCommit(file.Get())) {
+            throw std::runtime_error("FileCommit failed");
+        }
+        file.fclose();
+        if (!RenameOver(path_new, path)) {
+            throw std::runtime_error("Rename failed");
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump %s: %s. Continuing anyway.\n", path.filename().string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSaltedCache(const fs::path& path, uint256& nonce, std::vector<uint256>& entries)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return false;
+    }
+    try {
+        uint64_t version;
+        int client_version;
+        unsigned int flags;
+        file >> version;
+        if (version != SALTED_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        file >> client_version;
+        file >> flags;
+        // Entries saved by another release, or under other script verification rules, may not
+        // mean the same thing here.
+        if (client_version != CLIENT_VERSION || flags != STANDARD_SCRIPT_VERIFY_FLAGS) {
+            LogPrintf("Ignoring %s, which was written by a different version\n", path.filename().string());
+            return false;
+        }
+        file >> nonce;
+        file >> entries;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize %s: %s. Continuing anyway.\n", path.filename().string(), e.what());
+        return false;
+    }
+    // A crash would leave no newer dump behind, so don't load these entries again on the
+    // next start.
+    file.fclose();
+    try {
+        fs::remove(path);
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("Failed to delete %s: %s\n", path.filename().string(), fsbridge::get_filesystem_error_message(e));
+    }
+    return true;
+}
+
+bool DumpSignatureCache(const fs::path& path)
+{
+    const std::vector<uint256> entries{signatureCache.GetEntries()};
+    if (entries.empty()) return false;
+    if (!DumpSaltedCache(path, signatureCache.GetNonce(), entries)) return false;
+    LogPrintf("Dumped %u signature cache entries\n", entries.size());
+    return true;
+}
+
+bool LoadSignatureCache(const fs::path& path)
+{
+    uint256 nonce;
+    std::vector<uint256> entries;
+    if (!LoadSaltedCache(path, nonce, entries)) return false;
+    signatureCache.SetNonce(nonce);
+    for (const uint256& entry : entries) {
+        signatureCache.Set(entry);
+    }
+    LogPrintf("Loaded %u signature cache entries from disk\n", entries.size());
+    return true;
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -124,3 +237,12 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     if (store) signatureCache.Set(entry);
     return true;
 }
+
+bool BatchingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry;
+    signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
+    if (signatureCache.Get(entry, /* erase */ true)) return true;
+    m_batch.Add(pubkey, sighash, sig);
+    return true;
+}
@@ -6,6 +6,7 @@
 #ifndef BITCOINDX_SCRIPT_SIGCACHE_H
 #define BITCOINDX_SCRIPT_SIGCACHE_H
 
+#include <fs.h>
 #include <script/interpreter.h>
 #include <span.h>
 #include <util/hasher.h>
@@ -18,8 +19,14 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of independently locked parts of the signature cache. Enough for every
+// script check thread (see MAX_SCRIPTCHECK_THREADS) to usually use its own.
+static const size_t SIGNATURE_CACHE_SHARDS = 16;
+/** Default for -persistsigcache */
+static const bool DEFAULT_PERSIST_SIGCACHE = false;
 
 class CPubKey;
+class SchnorrBatch;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -33,6 +40,52 @@ public:
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
 };
 
+/**
+ * Signature checker that defers the verification of Schnorr signatures missing from
+ * the signature cache to a SchnorrBatch, and treats them as valid meanwhile. A script
+ * that passes with this checker is only valid once the batch verified as well.
+ */
+class BatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    SchnorrBatch& m_batch;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, PrecomputedTransactionData& txdataIn, SchnorrBatch& batch) : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, false, txdataIn), m_batch(batch) {}
+
+    bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
+};
+
 void InitSignatureCache();
 
+struct SignatureCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    //! Valid signatures dropped from the cache to make room for others.
+    uint64_t evictions;
+};
+
+//! Lookup and eviction counters of the signature cache since startup.
+SignatureCacheStats GetSignatureCacheStats();
+
+/**
+ * Write the nonce and the entries of a salted cache to path, through a temporary
+ * file so that an interrupted dump doesn't destroy the previous one. The dump
+ * records the client version and the standard script verification flags.
+ */
+bool DumpSaltedCache(const fs::path& path, const uint256& nonce, const std::vector<uint256>& entries);
+/**
+ * Read a file written by DumpSaltedCache, and delete it once read. Dumps of
+ * another client version or with other script verification flags are rejected.
+ */
+bool LoadSaltedCache(const fs::path& path, uint256& nonce, std::vector<uint256>& entries);
+
+/** Save the signature cache with its salt, so LoadSignatureCache can restore it
+ * after a restart. Nothing is written if the cache is empty, so a node that
+ * shuts down before using the cache keeps its previous dump. */
+bool DumpSignatureCache(const fs::path& path);
+/** Replace the salt and contents of the signature cache by a saved one. Must be
+ * called before anything else uses the cache. */
+bool LoadSignatureCache(const fs::path& path);
+
 #endif // BITCOINDX_SCRIPT_SIGCACHE_H
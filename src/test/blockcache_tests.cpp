@@ -0,0 +1,99 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <net.h>
+#include <node/blockcache.h>
+#include <node/blockstorage.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <validation.h>
+#include <version.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const SharedNetPayload> MakeBlock(size_t size, unsigned char fill)
+{
+    return std::make_shared<const SharedNetPayload>(std::vector<unsigned char>(size, fill));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_lru)
+{
+    SerializedBlockCache cache{300};
+    const uint256 hash_a{InsecureRand256()};
+    const uint256 hash_b{InsecureRand256()};
+    const uint256 hash_c{InsecureRand256()};
+
+    // Both forms of a block are cached separately
+    cache.Insert(hash_a, /* witness */ true, MakeBlock(100, 1));
+    cache.Insert(hash_a, /* witness */ false, MakeBlock(80, 2));
+    BOOST_CHECK_EQUAL(cache.Get(hash_a, true)->Bytes()[0], 1);
+    BOOST_CHECK_EQUAL(cache.Get(hash_a, false)->Bytes()[0], 2);
+    BOOST_CHECK(!cache.Get(hash_b, true));
+
+    // Looking up the witness form of A makes the other one the least recently used
+    cache.Insert(hash_b, true, MakeBlock(100, 3));
+    BOOST_CHECK(cache.Get(hash_a, true));
+    cache.Insert(hash_c, true, MakeBlock(100, 4));
+    BOOST_CHECK(!cache.Get(hash_a, false));
+    BOOST_CHECK(cache.Get(hash_a, true));
+    BOOST_CHECK(cache.Get(hash_b, true));
+    BOOST_CHECK(cache.Get(hash_c, true));
+
+    // Blocks larger than the cache are not added
+    cache.Insert(hash_b, false, MakeBlock(301, 5));
+    BOOST_CHECK(!cache.Get(hash_b, false));
+
+    SerializedBlockCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.entries, 3U);
+    BOOST_CHECK_EQUAL(stats.bytes, 300U);
+    BOOST_CHECK_EQUAL(stats.max_bytes, 300U);
+    BOOST_CHECK_EQUAL(stats.hits, 6U);
+    BOOST_CHECK_EQUAL(stats.misses, 3U);
+
+    // Shrinking evicts the least recently used blocks, 0 disables the cache
+    cache.SetMaxSize(150);
+    BOOST_CHECK(!cache.Get(hash_a, true));
+    BOOST_CHECK(cache.Get(hash_c, true));
+    cache.SetMaxSize(0);
+    BOOST_CHECK(!cache.Get(hash_c, true));
+    cache.Insert(hash_c, true, MakeBlock(1, 6));
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.entries, 0U);
+    BOOST_CHECK_EQUAL(stats.bytes, 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(blockcache_read_from_disk, TestingSetup)
+{
+    const CBlockIndex* genesis = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Genesis());
+    SerializedBlockCache& cache = m_node.chainman->m_blockman.m_block_cache;
+    const auto witness_block = GetSerializedBlock(cache, genesis, /* witness */ true, Params());
+    const auto no_witness_block = GetSerializedBlock(cache, genesis, /* witness */ false, Params());
+    BOOST_REQUIRE(witness_block && no_witness_block);
+
+    std::vector<unsigned char> expected;
+    CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, expected, 0, Params().GenesisBlock()};
+    BOOST_CHECK(Span<const unsigned char>{expected} == witness_block->Bytes());
+    BOOST_CHECK(Span<const unsigned char>{expected} == no_witness_block->Bytes());
+    BOOST_CHECK(GetSerializedBlock(cache, genesis, /* witness */ true, Params()) == witness_block);
+    BOOST_CHECK_EQUAL(cache.GetStats().hits, 1U);
+
+    // The raw read path checks the header against the index
+    std::vector<uint8_t> raw_block;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw_block, genesis, Params().MessageStart()));
+    CBlockIndex other_index{*genesis};
+    const uint256 other_hash{InsecureRand256()};
+    other_index.phashBlock = &other_hash;
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw_block, &other_index, Params().MessageStart()));
+    BOOST_CHECK(!GetSerializedBlock(cache, &other_index, /* witness */ true, Params()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <univalue.h>
+#include <util/golombrice.h>
 #include <util/strencodings.h>
 
 #include <boost/test/unit_test.hpp>
@@ -39,6 +40,102 @@ BOOST_AUTO_TEST_CASE(gcsfilter_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(golombrice_reader_test)
+{
+    FastRandomContext rng(/* fDeterministic */ true);
+    for (const uint8_t P : {0, 1, 19, 57, 63}) {
+        std::vector<unsigned char> data;
+        std::vector<uint64_t> values;
+        {
+            CVectorWriter stream(SER_NETWORK, 0, data, 0);
+            BitStreamWriter<CVectorWriter> bitwriter(stream);
+            for (int i = 0; i < 500; ++i) {
+                // Include quotients longer than the reader's buffer
+                const uint64_t q = i % 50 == 0 ? rng.randrange(200) : rng.randrange(4);
+                values.push_back((q << P) + (P ? rng.randbits(P) : 0));
+                GolombRiceEncode(bitwriter, P, values.back());
+            }
+            bitwriter.Flush();
+        }
+
+        GolombRiceReader reader(data);
+        VectorReader stream(SER_NETWORK, 0, data, 0);
+        BitStreamReader<VectorReader> bitreader(stream);
+        uint64_t value;
+        for (const uint64_t expected : values) {
+            BOOST_REQUIRE(reader.Decode(P, value));
+            BOOST_CHECK_EQUAL(value, expected);
+            BOOST_CHECK_EQUAL(GolombRiceDecode(bitreader, P), expected);
+        }
+        BOOST_CHECK_EQUAL((reader.BitsRead() + 7) / 8, data.size());
+
+        // Decoding stops at the end of the data
+        data.pop_back();
+        GolombRiceReader truncated(data);
+        size_t decoded = 0;
+        while (truncated.Decode(P, value)) ++decoded;
+        BOOST_CHECK_LT(decoded, values.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_batch_match_test)
+{
+    FastRandomContext rng(/* fDeterministic */ true);
+    auto random_element = [&rng] {
+        const uint256 hash = rng.rand256();
+        return GCSFilter::Element(hash.begin(), hash.begin() + 1 + rng.randrange(32));
+    };
+
+    std::vector<GCSFilter::ElementSet> filter_elements(20);
+    std::vector<GCSFilter> filters;
+    for (size_t i = 0; i < filter_elements.size(); ++i) {
+        const size_t num_elements = i % 5 == 0 ? 0 : rng.randrange(300);
+        while (filter_elements[i].size() < num_elements) filter_elements[i].insert(random_element());
+        // A small M makes for false positives
+        filters.emplace_back(GCSFilter::Params(rng.rand64(), rng.rand64(), 6, 64), filter_elements[i]);
+    }
+    std::vector<const GCSFilter*> filter_ptrs;
+    for (const GCSFilter& filter : filters) filter_ptrs.push_back(&filter);
+
+    // Query sets both much smaller and much larger than the filters
+    for (const size_t num_queries : {0, 1, 5, 100, 2000}) {
+        GCSFilter::ElementSet queries;
+        while (queries.size() < num_queries) queries.insert(random_element());
+        // Make the queries match some filters by their elements
+        if (num_queries > 0) {
+            for (size_t i = 1; i < filters.size(); i += 3) {
+                if (!filter_elements[i].empty()) queries.insert(*filter_elements[i].begin());
+            }
+        }
+
+        const std::vector<bool> results = GCSFilter::MatchAnyBatch(filter_ptrs, queries);
+        BOOST_REQUIRE_EQUAL(results.size(), filters.size());
+        for (size_t i = 0; i < filters.size(); ++i) {
+            bool expected = false;
+            for (const auto& query : queries) expected |= filters[i].Match(query);
+            BOOST_CHECK_EQUAL(results[i], expected);
+            BOOST_CHECK_EQUAL(filters[i].MatchAny(queries), expected);
+            if (num_queries > 0 && i % 3 == 1 && !filter_elements[i].empty()) BOOST_CHECK(expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_decode_errors)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 10; ++i) {
+        elements.insert(GCSFilter::Element(1, i));
+    }
+    const GCSFilter filter({0, 0, 10, 1 << 10}, elements);
+
+    std::vector<unsigned char> encoded = filter.GetEncoded();
+    BOOST_CHECK_NO_THROW(GCSFilter(filter.GetParams(), encoded));
+    encoded.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), encoded), std::ios_base::failure);
+    encoded.resize(encoded.size() - 2);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), encoded), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
 {
     GCSFilter filter;
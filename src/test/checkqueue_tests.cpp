@@ -122,6 +122,27 @@ struct FrozenCleanupCheck {
     void swap(FrozenCleanupCheck& x){std::swap(should_freeze, x.should_freeze);};
 };
 
+struct BlockingCheck {
+    static std::atomic<size_t> n_done;
+    static size_t n_wait_for;
+    // Blocking can't be the default initialized behavior given how the queue
+    // swaps in default initialized Checks.
+    bool should_block{false};
+    bool operator()() const
+    {
+        if (!should_block) {
+            n_done.fetch_add(1);
+            return true;
+        }
+        // Only completes once all other checks ran.
+        while (n_done.load() < n_wait_for) {
+            std::this_thread::yield();
+        }
+        return true;
+    }
+    void swap(BlockingCheck& x) { std::swap(should_block, x.should_block); };
+};
+
 // Static Allocations
 std::mutex FrozenCleanupCheck::m{};
 std::atomic<uint64_t> FrozenCleanupCheck::nFrozen{0};
@@ -130,6 +151,8 @@ Mutex UniqueCheck::m;
 std::unordered_multiset<size_t> UniqueCheck::results;
 std::atomic<size_t> FakeCheckCheckCompletion::n_calls{0};
 std::atomic<size_t> MemoryCheck::fake_allocated_memory{0};
+std::atomic<size_t> BlockingCheck::n_done{0};
+size_t BlockingCheck::n_wait_for{0};
 
 // Queue Typedefs
 typedef CCheckQueue<FakeCheckCheckCompletion> Correct_Queue;
@@ -138,6 +161,7 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<BlockingCheck> Blocking_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
@@ -252,6 +276,26 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
     fail_queue->StopWorkerThreads();
 }
 
+// Test that the checks queued behind a check that blocks its thread are stolen
+// by the other threads.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Stealing)
+{
+    // A batch size of one spreads the checks over the workers' deques one by one.
+    auto queue = std::make_unique<Blocking_Queue>(1);
+    queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+    for (size_t blocking = 0; blocking < 2 * SCRIPT_CHECK_THREADS; ++blocking) {
+        std::vector<BlockingCheck> vChecks(100);
+        vChecks[blocking].should_block = true;
+        BlockingCheck::n_done = 0;
+        BlockingCheck::n_wait_for = vChecks.size() - 1;
+        CCheckQueueControl<BlockingCheck> control(queue.get());
+        control.Add(vChecks);
+        BOOST_REQUIRE(control.Wait());
+        BOOST_REQUIRE_EQUAL(BlockingCheck::n_done, BlockingCheck::n_wait_for);
+    }
+    queue->StopWorkerThreads();
+}
+
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
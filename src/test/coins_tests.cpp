@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <attributes.h>
+#include <checkqueue.h>
 #include <clientversion.h>
 #include <coins.h>
+#include <primitives/block.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
@@ -12,7 +14,9 @@
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <validation.h>
 
+#include <atomic>
 #include <map>
 #include <vector>
 
@@ -271,6 +275,76 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
 
     CCoinsViewDB db_base{"test", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
     SimulationTest(&db_base, true);
+
+    CCoinsViewDB background_db{"test_background", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
+    CCoinsViewBackgroundFlush background_base{background_db, /*background*/ true};
+    SimulationTest(&background_base, true);
+}
+
+BOOST_AUTO_TEST_CASE(coins_background_flush)
+{
+    CCoinsViewDB db{"test", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
+    CCoinsMap::ChunkPool pool{1024};
+    CCoinsViewBackgroundFlush flush_view{db, /*background*/ true};
+    BOOST_CHECK(flush_view.IsBackground());
+
+    const COutPoint spent{InsecureRand256(), 0};
+    const uint256 first_block{InsecureRand256()};
+    {
+        CCoinsViewCache cache{&flush_view};
+        cache.AddCoin(spent, Coin(CTxOut(100, CScript() << OP_TRUE), 1, false), false);
+        cache.SetBestBlock(first_block);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(flush_view.WaitForFlush());
+    BOOST_CHECK(db.HaveCoin(spent));
+    BOOST_CHECK(db.GetBestBlock() == first_block);
+
+    // Whether or not the write already completed, the view reflects it.
+    std::vector<COutPoint> added;
+    const uint256 second_block{InsecureRand256()};
+    {
+        CCoinsViewCache cache{&flush_view, &pool};
+        BOOST_CHECK(cache.SpendCoin(spent));
+        for (uint32_t i = 0; i < 1000; ++i) {
+            added.emplace_back(InsecureRand256(), i);
+            cache.AddCoin(added.back(), Coin(CTxOut(200, CScript() << OP_TRUE), 2, false), false);
+        }
+        cache.SetBestBlock(second_block);
+        BOOST_CHECK(cache.Flush());
+    }
+    // The callback runs once the write is on disk, possibly on the writer thread.
+    std::atomic<bool> written{false};
+    flush_view.OnWritten([&] { written = db.GetBestBlock() == second_block; });
+    BOOST_CHECK(flush_view.GetBestBlock() == second_block);
+    BOOST_CHECK(!flush_view.HaveCoin(spent));
+    Coin coin;
+    BOOST_CHECK(!flush_view.GetCoin(spent, coin));
+    for (const COutPoint& outpoint : added) {
+        BOOST_CHECK(flush_view.GetCoin(outpoint, coin));
+        BOOST_CHECK_EQUAL(coin.out.nValue, 200);
+    }
+
+    // The coins count as memory held by the view until they are released, which hands
+    // their chunks back to the pool of the cache they came from.
+    const size_t pooled_chunks{pool.chunk_count()};
+    BOOST_CHECK_GT(flush_view.DynamicMemoryUsage(), added.size() * sizeof(Coin));
+
+    BOOST_CHECK(flush_view.WaitForFlush());
+    BOOST_CHECK(written);
+    BOOST_CHECK(db.GetBestBlock() == second_block);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(!db.HaveCoin(spent));
+    for (const COutPoint& outpoint : added) {
+        BOOST_CHECK(db.HaveCoin(outpoint));
+    }
+
+    flush_view.ReleaseWritten();
+    BOOST_CHECK_EQUAL(flush_view.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK_GT(pool.chunk_count(), pooled_chunks);
+    for (const COutPoint& outpoint : added) {
+        BOOST_CHECK(flush_view.HaveCoin(outpoint));
+    }
 }
 
 // Store of all necessary tx and undo data for next test
@@ -878,4 +952,48 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewTest base;
+    std::vector<COutPoint> funding;
+    {
+        CCoinsViewCache setup(&base);
+        for (uint32_t i = 0; i < 4; ++i) {
+            funding.emplace_back(InsecureRand256(), i);
+            setup.AddCoin(funding.back(), Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 1, false), false);
+        }
+        setup.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(setup.Flush());
+    }
+
+    CCoinsViewCache cache(&base);
+    // A spend that was not flushed yet must not be undone by the prefetch.
+    BOOST_CHECK(cache.SpendCoin(funding[0]));
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(VALUE1, CScript() << OP_TRUE);
+    CMutableTransaction parent;
+    parent.vin = {CTxIn(funding[0]), CTxIn(funding[1]), CTxIn(funding[2])};
+    parent.vout.emplace_back(VALUE2, CScript() << OP_TRUE);
+    const COutPoint missing(InsecureRand256(), 0);
+    CMutableTransaction child;
+    child.vin = {CTxIn(COutPoint(parent.GetHash(), 0)), CTxIn(missing)};
+    child.vout.emplace_back(VALUE3, CScript() << OP_TRUE);
+    CBlock block;
+    block.vtx = {MakeTransactionRef(coinbase), MakeTransactionRef(parent), MakeTransactionRef(child)};
+
+    CCheckQueue<CCoinsPrefetchCheck> queue{128};
+    queue.StartWorkerThreads(2);
+    BOOST_CHECK_EQUAL(PrefetchBlockInputs(block, cache, base, queue), 2U);
+    queue.StopWorkerThreads();
+
+    BOOST_CHECK(cache.AccessCoin(funding[0]).IsSpent());
+    BOOST_CHECK(cache.HaveCoinInCache(funding[1]));
+    BOOST_CHECK(cache.HaveCoinInCache(funding[2]));
+    BOOST_CHECK(!cache.HaveCoinInCache(funding[3]));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 3U);
+    BOOST_CHECK_EQUAL(cache.AccessCoin(funding[1]).out.nValue, VALUE1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
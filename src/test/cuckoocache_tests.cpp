@@ -368,4 +368,55 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+using ShardedTestCache = CuckooCache::sharded_cache<uint256, SignatureCacheHasher, SignatureCacheShardHasher, 16>;
+
+BOOST_AUTO_TEST_CASE(cuckoocache_sharded_hit_rate_ok)
+{
+    // Same threshold as cuckoocache_hit_rate_ok: sharding should not cost hits
+    double HitRateThresh = 0.98;
+    size_t megabytes = 4;
+    for (double load = 0.1; load < 2; load *= 2) {
+        double hits = test_cache<ShardedTestCache>(megabytes, load);
+        BOOST_CHECK(normalize_hit_rate(hits, load) > HitRateThresh);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_sharded_erase_ok)
+{
+    test_cache_erase<ShardedTestCache>(4);
+    test_cache_generations<ShardedTestCache>();
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_sharded_stats)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    auto set = std::make_unique<ShardedTestCache>();
+    // Room for 16 elements per shard
+    const uint32_t n_elems = set->setup_bytes(16 * 16 * sizeof(uint256));
+    BOOST_CHECK_EQUAL(n_elems, 16U * 16U);
+
+    std::vector<uint256> hashes(n_elems / 2);
+    for (uint256& h : hashes) h = InsecureRand256();
+    for (const uint256& h : hashes) set->insert(h);
+    // Re-inserting an element that is present evicts nothing
+    set->insert(hashes.front());
+
+    uint32_t found{0};
+    for (const uint256& h : hashes) found += set->contains(h, false);
+    BOOST_CHECK(!set->contains(InsecureRand256(), false));
+
+    auto stats = set->get_stats();
+    BOOST_CHECK_EQUAL(stats.hits, found);
+    BOOST_CHECK_EQUAL(stats.misses, hashes.size() + 1 - found);
+    BOOST_CHECK_EQUAL(stats.hits + stats.misses, hashes.size() + 1);
+
+    // Overfilling the cache has to drop elements, and each insert drops at most one
+    const uint64_t evictions_before = stats.evictions;
+    const size_t n_overfill = 4 * n_elems;
+    for (size_t i = 0; i < n_overfill; ++i) set->insert(InsecureRand256());
+    stats = set->get_stats();
+    BOOST_CHECK(stats.evictions > evictions_before);
+    BOOST_CHECK(stats.evictions - evictions_before <= n_overfill);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -24,6 +24,14 @@ struct RandomHasher {
         return fuzzed_data_provider_ptr->ConsumeIntegral<uint32_t>();
     }
 };
+
+struct RandomShardHasher {
+    size_t operator()(const bool& /* unused */) const
+    {
+        assert(fuzzed_data_provider_ptr != nullptr);
+        return fuzzed_data_provider_ptr->ConsumeIntegral<size_t>();
+    }
+};
 } // namespace
 
 FUZZ_TARGET(cuckoocache)
@@ -46,3 +54,23 @@ FUZZ_TARGET(cuckoocache)
     }
     fuzzed_data_provider_ptr = nullptr;
 }
+
+FUZZ_TARGET(cuckoocache_sharded)
+{
+    FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
+    fuzzed_data_provider_ptr = &fuzzed_data_provider;
+    CuckooCache::sharded_cache<int, RandomHasher, RandomShardHasher, 4> cuckoo_cache{};
+    cuckoo_cache.setup_bytes(fuzzed_data_provider.ConsumeIntegralInRange<size_t>(0, 4096));
+    uint64_t lookups{0};
+    while (fuzzed_data_provider.ConsumeBool()) {
+        if (fuzzed_data_provider.ConsumeBool()) {
+            cuckoo_cache.insert(fuzzed_data_provider.ConsumeBool());
+        } else {
+            cuckoo_cache.contains(fuzzed_data_provider.ConsumeBool(), fuzzed_data_provider.ConsumeBool());
+            ++lookups;
+        }
+    }
+    const auto stats = cuckoo_cache.get_stats();
+    assert(stats.hits + stats.misses == lookups);
+    fuzzed_data_provider_ptr = nullptr;
+}
@@ -92,6 +92,15 @@ FUZZ_TARGET(golomb_rice)
 
     assert(encoded_deltas == decoded_deltas);
 
+    {
+        GolombRiceReader reader(MakeUCharSpan(golomb_rice_data).subspan(GetSizeOfCompactSize(encoded_deltas.size())));
+        for (const uint64_t encoded_delta : encoded_deltas) {
+            uint64_t delta;
+            assert(reader.Decode(BASIC_FILTER_P, delta));
+            assert(delta == encoded_delta);
+        }
+    }
+
     {
         const std::vector<uint8_t> random_bytes = ConsumeRandomLengthByteVector(fuzzed_data_provider, 1024);
         VectorReader stream{SER_NETWORK, 0, random_bytes, 0};
@@ -101,11 +110,20 @@ FUZZ_TARGET(golomb_rice)
         } catch (const std::ios_base::failure&) {
             return;
         }
+        // The word-wise reader decodes the same values until the data ends
+        GolombRiceReader reader(MakeUCharSpan(random_bytes).subspan(random_bytes.size() - stream.size()));
+        bool reader_ended = false;
         BitStreamReader<VectorReader> bitreader(stream);
         for (uint32_t i = 0; i < std::min<uint32_t>(n, 1024); ++i) {
+            uint64_t value;
+            const bool decoded = !reader_ended && reader.Decode(BASIC_FILTER_P, value);
+            reader_ended = !decoded;
             try {
-                (void)GolombRiceDecode(bitreader, BASIC_FILTER_P);
+                const uint64_t expected = GolombRiceDecode(bitreader, BASIC_FILTER_P);
+                assert(decoded && value == expected);
             } catch (const std::ios_base::failure&) {
+                assert(!decoded);
+                break;
             }
         }
     }
@@ -344,4 +344,54 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_batch)
+{
+    SchnorrBatch batch;
+    BOOST_CHECK(batch.Verify());
+
+    std::vector<std::vector<unsigned char>> sigs;
+    std::vector<uint256> msgs;
+    std::vector<XOnlyPubKey> pubkeys;
+    // The first 15 signatures are by 5 keys that sign 3 each, the last 5 by keys of their own.
+    std::vector<CKey> keys(10);
+    for (CKey& key : keys) key.MakeNewKey(true);
+    for (int i = 0; i < 20; ++i) {
+        const CKey& key = keys[i < 15 ? i % 5 : i - 10];
+        msgs.push_back(InsecureRand256());
+        pubkeys.emplace_back(key.GetPubKey());
+        sigs.emplace_back(64);
+        BOOST_CHECK(key.SignSchnorr(msgs.back(), sigs.back()));
+    }
+    for (size_t i = 0; i < sigs.size(); ++i) {
+        batch.Add(pubkeys[i], msgs[i], sigs[i]);
+    }
+    BOOST_CHECK_EQUAL(batch.size(), sigs.size());
+    BOOST_CHECK(batch.Verify());
+
+    // A single invalid signature makes the batch fail, wherever it is.
+    for (size_t bad : {size_t{0}, size_t{7}, size_t{14}, size_t{19}}) {
+        batch.clear();
+        for (size_t i = 0; i < sigs.size(); ++i) {
+            batch.Add(pubkeys[i], i == bad ? InsecureRand256() : msgs[i], sigs[i]);
+        }
+        BOOST_CHECK(!batch.Verify());
+    }
+
+    // Neither does an s that is not below the group order, even as the first signature.
+    for (size_t bad : {size_t{0}, size_t{5}, size_t{17}}) {
+        batch.clear();
+        for (size_t i = 0; i < sigs.size(); ++i) {
+            std::vector<unsigned char> sig{sigs[i]};
+            if (i == bad) std::fill(sig.begin() + 32, sig.end(), 0xff);
+            batch.Add(pubkeys[i], msgs[i], sig);
+        }
+        BOOST_CHECK(!batch.Verify());
+    }
+
+    batch.clear();
+    BOOST_CHECK(batch.empty());
+    batch.Add(pubkeys[0], msgs[0], sigs[1]);
+    BOOST_CHECK(!batch.Verify());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/setup_common.h>
+#include <util/mpmcqueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mpmcqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_fifo)
+{
+    MPMCQueue<std::unique_ptr<int>> queue{3};
+    BOOST_CHECK_EQUAL(queue.Capacity(), 3U);
+    std::unique_ptr<int> value;
+    BOOST_CHECK(!queue.TryPop(value));
+
+    // Go around the ring several times
+    int next_push{0}, next_pop{0};
+    for (int round = 0; round < 5; ++round) {
+        while (true) {
+            auto item = std::make_unique<int>(next_push);
+            if (!queue.TryPush(std::move(item))) {
+                // A failed push leaves the item with the caller
+                BOOST_REQUIRE(item);
+                BOOST_CHECK_EQUAL(*item, next_push);
+                break;
+            }
+            ++next_push;
+        }
+        BOOST_CHECK_EQUAL(queue.Size(), 3U);
+        BOOST_CHECK(queue.TryPop(value));
+        BOOST_CHECK_EQUAL(*value, next_pop++);
+        BOOST_CHECK(queue.TryPop(value));
+        BOOST_CHECK_EQUAL(*value, next_pop++);
+        BOOST_CHECK_EQUAL(queue.Size(), 1U);
+    }
+    while (queue.TryPop(value)) {
+        BOOST_CHECK_EQUAL(*value, next_pop++);
+    }
+    BOOST_CHECK_EQUAL(next_pop, next_push);
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_single_slot)
+{
+    MPMCQueue<int> queue{1};
+    int value{0};
+    for (int i = 0; i < 3; ++i) {
+        BOOST_CHECK(queue.TryPush(int{i}));
+        BOOST_CHECK(!queue.TryPush(int{-1}));
+        BOOST_CHECK(queue.TryPop(value));
+        BOOST_CHECK_EQUAL(value, i);
+        BOOST_CHECK(!queue.TryPop(value));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mpmcqueue_threads)
+{
+    static constexpr int NUM_PRODUCERS{4};
+    static constexpr int NUM_CONSUMERS{4};
+    static constexpr int ITEMS_PER_PRODUCER{20000};
+
+    MPMCQueue<int> queue{16};
+    std::atomic<int> consumed{0};
+    // Boost.Test assertions are not thread safe, so only record failures here
+    std::atomic<bool> out_of_order{false};
+    std::vector<std::atomic<int>> seen(NUM_PRODUCERS * ITEMS_PER_PRODUCER);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < NUM_PRODUCERS; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                int item = p * ITEMS_PER_PRODUCER + i;
+                while (!queue.TryPush(std::move(item))) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < NUM_CONSUMERS; ++c) {
+        threads.emplace_back([&] {
+            int last[NUM_PRODUCERS];
+            std::fill(last, last + NUM_PRODUCERS, -1);
+            while (consumed < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
+                int item;
+                if (!queue.TryPop(item)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++seen[item];
+                ++consumed;
+                // Items of one producer are popped in the order they were pushed
+                const int producer = item / ITEMS_PER_PRODUCER;
+                if (item <= last[producer]) out_of_order = true;
+                last[producer] = item;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK(!out_of_order);
+    BOOST_CHECK(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& count) { return count == 1; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,9 +10,11 @@
 #include <net.h>
 #include <netaddress.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <test/util/net.h>
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 #include <util/string.h>
@@ -835,4 +837,106 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK_EQUAL(IsLocal(addr), false);
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(socket_handler_shards)
+{
+    CSerializedNetMsg ping = CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, uint64_t{0});
+    std::vector<unsigned char> wire;
+    V1TransportSerializer{}.prepareForTransport(ping, wire);
+    wire.insert(wire.end(), ping.data.begin(), ping.data.end());
+
+    // Whichever way socket events are waited for, the socket handler shards
+    // together serve every peer exactly once.
+    for (const bool use_epoll : {false, true}) {
+        CAddrMan addrman;
+        ConnmanTestMsg connman{0x1337, 0x1337, addrman};
+        CConnman::Options options;
+        options.nReceiveFloodSize = 100000;
+        options.m_use_epoll = use_epoll;
+        options.m_socket_threads = 3;
+        connman.Init(options);
+
+        std::vector<CNode*> nodes;
+        std::vector<SOCKET> remote_sockets;
+        for (NodeId id = 0; id < 10; ++id) {
+            int fds[2];
+            BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+            nodes.push_back(new CNode{id, NODE_NETWORK, static_cast<SOCKET>(fds[0]), CAddress(), /* nKeyedNetGroupIn */ 0,
+                                      /* nLocalHostNonceIn */ 0, CAddress(), /* pszDest */ "",
+                                      ConnectionType::INBOUND, /* inbound_onion */ false});
+            connman.AddTestNode(*nodes.back());
+            remote_sockets.push_back(fds[1]);
+            BOOST_REQUIRE_EQUAL(send(fds[1], wire.data(), wire.size(), MSG_NOSIGNAL), static_cast<ssize_t>(wire.size()));
+        }
+
+        connman.SocketHandlerOnce();
+        for (CNode* node : nodes) {
+            BOOST_CHECK_EQUAL(WITH_LOCK(node->cs_vRecv, return node->nRecvBytes), wire.size());
+            BOOST_CHECK_EQUAL(WITH_LOCK(node->cs_vProcessMsg, return node->vProcessMsg.size()), 1U);
+        }
+        BOOST_CHECK_EQUAL(connman.GetTotalBytesRecv(), nodes.size() * wire.size());
+
+        connman.ClearTestNodes();
+        for (SOCKET socket : remote_sockets) {
+            CloseSocket(socket);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_shared_payload)
+{
+    CAddrMan addrman;
+    ConnmanTestMsg connman{0x1337, 0x1337, addrman};
+    CConnman::Options options;
+    options.nSendBufferMaxSize = 10000000;
+    connman.Init(options);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    CNode* node = new CNode{0, NODE_NETWORK, static_cast<SOCKET>(fds[0]), CAddress(), /* nKeyedNetGroupIn */ 0,
+                            /* nLocalHostNonceIn */ 0, CAddress(), /* pszDest */ "",
+                            ConnectionType::INBOUND, /* inbound_onion */ false};
+    connman.AddTestNode(*node);
+
+    // Queue shared payloads, larger than the socket buffers, between owned
+    // ones; what arrives must be the messages in order.
+    const auto payload = std::make_shared<const SharedNetPayload>(std::vector<unsigned char>(1000000, 0x42));
+    const CNetMsgMaker msg_maker(INIT_PROTO_VERSION);
+    std::vector<unsigned char> expected;
+    for (int i = 0; i < 3; ++i) {
+        CSerializedNetMsg ping = msg_maker.Make(NetMsgType::PING, uint64_t(i));
+        std::vector<unsigned char> header;
+        V1TransportSerializer{}.prepareForTransport(ping, header);
+        expected.insert(expected.end(), header.begin(), header.end());
+        expected.insert(expected.end(), ping.data.begin(), ping.data.end());
+        connman.PushMessage(node, std::move(ping));
+
+        CSerializedNetMsg block;
+        block.m_type = NetMsgType::BLOCK;
+        block.m_shared_payload = payload;
+        V1TransportSerializer{}.prepareForTransport(block, header);
+        expected.insert(expected.end(), header.begin(), header.end());
+        expected.insert(expected.end(), payload->Bytes().begin(), payload->Bytes().end());
+        connman.PushMessage(node, std::move(block));
+    }
+
+    std::vector<unsigned char> received;
+    std::vector<unsigned char> buf(1 << 16);
+    while (received.size() < expected.size()) {
+        ssize_t n;
+        while ((n = recv(fds[1], buf.data(), buf.size(), MSG_DONTWAIT)) > 0) {
+            received.insert(received.end(), buf.begin(), buf.begin() + n);
+        }
+        if (received.size() < expected.size()) connman.SocketHandlerOnce();
+    }
+    BOOST_CHECK(received == expected);
+    BOOST_CHECK(WITH_LOCK(node->cs_vSend, return node->vSendMsg.empty()));
+    BOOST_CHECK_EQUAL(connman.GetTotalBytesSent(), expected.size());
+
+    connman.ClearTestNodes();
+    SOCKET remote_socket = fds[1];
+    CloseSocket(remote_socket);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+// Copyright (c) 2021-2022 The Bitcoin DX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <openhashmap.h>
+#include <test/util/setup_common.h>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(openhashmap_tests, BasicTestingSetup)
+
+namespace {
+//! Hasher with many collisions, to exercise long probe sequences.
+struct CollidingHasher {
+    size_t operator()(uint32_t key) const { return (size_t{key} % 7) * 0x9E3779B97F4A7C15ULL; }
+};
+
+template <typename Hash>
+void CheckEqual(const OpenHashMap<uint32_t, uint64_t, Hash>& map, const std::map<uint32_t, uint64_t>& expected)
+{
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    size_t count{0};
+    for (const auto& [key, value] : map) {
+        auto it = expected.find(key);
+        BOOST_REQUIRE(it != expected.end());
+        BOOST_CHECK_EQUAL(it->second, value);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, expected.size());
+    for (const auto& [key, value] : expected) {
+        auto it = map.find(key);
+        BOOST_REQUIRE(it != map.end());
+        BOOST_CHECK_EQUAL(it->second, value);
+    }
+}
+
+template <typename Hash>
+void RandomOperations(FastRandomContext& rng, uint32_t key_range)
+{
+    OpenHashMap<uint32_t, uint64_t, Hash> map;
+    std::map<uint32_t, uint64_t> expected;
+    for (int i = 0; i < 20000; ++i) {
+        const uint32_t key = rng.randrange(key_range);
+        const uint64_t value = rng.rand64();
+        switch (rng.randrange(5)) {
+        case 0: {
+            auto [it, inserted] = map.emplace(key, value);
+            BOOST_CHECK_EQUAL(inserted, expected.emplace(key, value).second);
+            BOOST_CHECK_EQUAL(it->first, key);
+            break;
+        }
+        case 1: {
+            auto [it, inserted] = map.try_emplace(key, value);
+            BOOST_CHECK_EQUAL(inserted, expected.try_emplace(key, value).second);
+            BOOST_CHECK_EQUAL(it->second, expected[key]);
+            break;
+        }
+        case 2:
+            map[key] = value;
+            expected[key] = value;
+            break;
+        case 3:
+            BOOST_CHECK_EQUAL(map.erase(key), expected.erase(key));
+            break;
+        case 4: {
+            auto it = map.find(key);
+            BOOST_CHECK_EQUAL(it != map.end(), expected.count(key) == 1);
+            if (it != map.end()) {
+                expected.erase(key);
+                map.erase(it);
+            }
+            break;
+        }
+        }
+        if (rng.randrange(5000) == 0) {
+            map.clear();
+            expected.clear();
+        }
+    }
+    CheckEqual(map, expected);
+
+    // Erase every other element while iterating, like BatchWrite erases all of them.
+    bool erase{false};
+    for (auto it = map.begin(); it != map.end();) {
+        if ((erase = !erase)) {
+            expected.erase(it->first);
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    CheckEqual(map, expected);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(openhashmap_random_operations)
+{
+    FastRandomContext rng{true};
+    RandomOperations<std::hash<uint32_t>>(rng, 500);
+    RandomOperations<std::hash<uint32_t>>(rng, 50000);
+    RandomOperations<CollidingHasher>(rng, 200);
+}
+
+BOOST_AUTO_TEST_CASE(openhashmap_reference_stability)
+{
+    OpenHashMap<uint32_t, uint64_t> map;
+    auto& first = map[0];
+    first = 42;
+    for (uint32_t i = 1; i < 10000; ++i) {
+        map[i] = i;
+    }
+    BOOST_CHECK(map.bucket_count() >= 10000);
+    BOOST_CHECK_EQUAL(&first, &map.find(0)->second);
+    BOOST_CHECK_EQUAL(first, 42U);
+
+    // Erased nodes are reused for new elements.
+    const size_t chunks{map.chunk_count()};
+    for (uint32_t i = 0; i < 5000; ++i) {
+        BOOST_CHECK_EQUAL(map.erase(i), 1U);
+    }
+    for (uint32_t i = 10000; i < 15000; ++i) {
+        map[i] = i;
+    }
+    BOOST_CHECK_EQUAL(map.chunk_count(), chunks);
+    BOOST_CHECK_EQUAL(map.size(), 10000U);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(map.chunk_count(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(openhashmap_move_salted)
+{
+    // Every SaltedOutpointHasher has its own salt, so a moved-to map has to keep
+    // hashing with the salt the elements were inserted with.
+    CCoinsMap map;
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        map.try_emplace(outpoints.back());
+    }
+    CCoinsMap moved{std::move(map)};
+    CCoinsMap assigned;
+    assigned.try_emplace(COutPoint{InsecureRand256(), 0});
+    assigned = std::move(moved);
+    BOOST_CHECK_EQUAL(assigned.size(), outpoints.size());
+    for (const COutPoint& outpoint : outpoints) {
+        BOOST_CHECK(assigned.count(outpoint));
+    }
+    assigned.try_emplace(outpoints[0]);
+    BOOST_CHECK_EQUAL(assigned.size(), outpoints.size());
+}
+
+BOOST_AUTO_TEST_CASE(openhashmap_chunk_pool)
+{
+    using Map = OpenHashMap<uint32_t, uint64_t>;
+    Map::ChunkPool pool{4};
+    {
+        Map map{&pool};
+        for (uint32_t i = 0; i < 3 * Map::NODES_PER_CHUNK; ++i) {
+            map[i] = i;
+        }
+        BOOST_CHECK_EQUAL(map.chunk_count(), 3U);
+        BOOST_CHECK_EQUAL(pool.chunk_count(), 0U);
+
+        // Clearing hands all chunks to the pool, and refilling takes them back.
+        map.clear();
+        BOOST_CHECK_EQUAL(map.chunk_count(), 0U);
+        BOOST_CHECK_EQUAL(pool.chunk_count(), 3U);
+        map[0] = 0;
+        BOOST_CHECK_EQUAL(map.chunk_count(), 1U);
+        BOOST_CHECK_EQUAL(pool.chunk_count(), 2U);
+    }
+    // Destroying a map clears it.
+    BOOST_CHECK_EQUAL(pool.chunk_count(), 3U);
+
+    // Another map using the pool reuses the chunks, and the pool never keeps
+    // more than its maximum when they come back.
+    {
+        Map map{&pool};
+        for (uint32_t i = 0; i < 6 * Map::NODES_PER_CHUNK; ++i) {
+            map[i] = i;
+        }
+        BOOST_CHECK_EQUAL(pool.chunk_count(), 0U);
+        Map moved{std::move(map)};
+        BOOST_CHECK_EQUAL(moved.chunk_pool(), &pool);
+        BOOST_CHECK_EQUAL(moved.chunk_count(), 6U);
+    }
+    BOOST_CHECK_EQUAL(pool.chunk_count(), pool.max_chunks());
+
+    pool.clear();
+    BOOST_CHECK_EQUAL(pool.chunk_count(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(openhashmap_coins_memory_usage)
+{
+    // Holding the same coins takes less memory than with std::unordered_map.
+    CCoinsMap map;
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> unordered;
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0U);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const COutPoint outpoint{InsecureRand256(), i};
+        map.try_emplace(outpoint);
+        unordered.try_emplace(outpoint);
+    }
+    BOOST_CHECK_LT(memusage::DynamicUsage(map), memusage::DynamicUsage(unordered));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
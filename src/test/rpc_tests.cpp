@@ -3,16 +3,21 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <rpc/client.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 
 #include <core_io.h>
 #include <interfaces/chain.h>
 #include <node/context.h>
+#include <script/script.h>
 #include <test/util/setup_common.h>
+#include <txmempool.h>
 #include <util/time.h>
+#include <validation.h>
 
 #include <any>
+#include <map>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
@@ -24,10 +29,10 @@
 class RPCTestingSetup : public TestingSetup
 {
 public:
-    UniValue CallRPC(std::string args);
+    UniValue CallRPC(std::string args, JSONStreamWriter* result_stream = nullptr);
 };
 
-UniValue RPCTestingSetup::CallRPC(std::string args)
+UniValue RPCTestingSetup::CallRPC(std::string args, JSONStreamWriter* result_stream)
 {
     std::vector<std::string> vArgs;
     boost::split(vArgs, args, boost::is_any_of(" \t"));
@@ -37,6 +42,7 @@ UniValue RPCTestingSetup::CallRPC(std::string args)
     request.context = &m_node;
     request.strMethod = strMethod;
     request.params = RPCConvertValues(strMethod, vArgs);
+    request.result_stream = result_stream;
     if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
     try {
         UniValue result = tableRPC.execute(request);
@@ -473,4 +479,91 @@ BOOST_AUTO_TEST_CASE(help_example)
     BOOST_CHECK_NE(HelpExampleRpcNamed("foo", {{"arg", true}}), HelpExampleRpcNamed("foo", {{"arg", "true"}}));
 }
 
+BOOST_AUTO_TEST_CASE(rpc_stream_result)
+{
+    // Written in small pieces, the stream matches what UniValue writes
+    std::string streamed;
+    JSONStreamWriter writer{[&](std::string chunk) {
+        BOOST_CHECK(!chunk.empty());
+        streamed += chunk;
+    }, /* flush_size */ 8};
+    UniValue members(UniValue::VOBJ);
+    members.pushKV("a\"b", 1);
+    members.pushKV("c", NullUniValue);
+    writer.BeginObject();
+    writer.Members(members);
+    writer.Key("list");
+    writer.BeginArray();
+    writer.Value("x");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.BeginArray();
+    writer.Value(true);
+    writer.Value(2.5);
+    writer.EndArray();
+    writer.EndArray();
+    writer.EndObject();
+    BOOST_CHECK(writer.HasOutput());
+    streamed += writer.TakeBuffer();
+    BOOST_CHECK_EQUAL(streamed, "{\"a\\\"b\":1,\"c\":null,\"list\":[\"x\",{},[true,2.5]]}");
+
+    // Handlers writing their result to the stream produce the same result
+    const std::string genesis = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Genesis()->GetBlockHash().GetHex());
+    for (const std::string& args : std::vector<std::string>{"getblock " + genesis + " 1", "getblock " + genesis + " 2", "getrawmempool true"}) {
+        streamed.clear();
+        JSONStreamWriter result_writer{[&](std::string chunk) { streamed += chunk; }, /* flush_size */ 64};
+        BOOST_CHECK(CallRPC(args, &result_writer).isNull());
+        streamed += result_writer.TakeBuffer();
+        BOOST_CHECK_EQUAL(streamed, CallRPC(args).write());
+    }
+
+    // The mempool is described in batches, leaving out transactions that left it in the meantime
+    CTxMemPool& mempool = *m_node.mempool;
+    std::map<uint256, CTransactionRef> txs;
+    {
+        LOCK2(cs_main, mempool.cs);
+        TestMemPoolEntryHelper entry;
+        for (uint32_t i = 0; i < 2500; ++i) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint{InsecureRand256(), i});
+            tx.vout.emplace_back(i + 1, CScript() << OP_TRUE);
+            const CTransactionRef ref = MakeTransactionRef(tx);
+            mempool.addUnchecked(entry.Fee(1000 + i).Time(i).FromTx(ref));
+            txs.emplace(ref->GetHash(), ref);
+        }
+    }
+    std::vector<uint256> txids;
+    WITH_LOCK(mempool.cs, mempool.queryHashes(txids));
+    streamed.clear();
+    JSONStreamWriter mempool_writer{[&](std::string chunk) {
+        if (streamed.empty()) {
+            // The first batch is being written, so the last one is yet to be described
+            LOCK(mempool.cs);
+            for (size_t i = txids.size() - 10; i < txids.size(); ++i) {
+                mempool.removeRecursive(*txs.at(txids[i]), MemPoolRemovalReason::CONFLICT);
+            }
+        }
+        streamed += chunk;
+    }, /* flush_size */ 64};
+    BOOST_CHECK(CallRPC("getrawmempool true", &mempool_writer).isNull());
+    streamed += mempool_writer.TakeBuffer();
+    UniValue streamed_mempool;
+    BOOST_CHECK(streamed_mempool.read(streamed));
+    const UniValue expected_mempool = CallRPC("getrawmempool true");
+    BOOST_CHECK_EQUAL(expected_mempool.size(), txids.size() - 10);
+    BOOST_CHECK_EQUAL(streamed_mempool.size(), expected_mempool.size());
+    for (const std::string& txid : expected_mempool.getKeys()) {
+        BOOST_CHECK_EQUAL(streamed_mempool[txid].write(), expected_mempool[txid].write());
+    }
+
+    // A sink that takes no more output stops the handler
+    int chunks{0};
+    JSONStreamWriter closed_writer{[&](std::string chunk) {
+        ++chunks;
+        throw JSONStreamClosed();
+    }, /* flush_size */ 64};
+    BOOST_CHECK_THROW(CallRPC("getblock " + genesis + " 2", &closed_writer), std::runtime_error);
+    BOOST_CHECK_EQUAL(chunks, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
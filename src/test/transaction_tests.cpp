@@ -556,6 +556,41 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     scriptcheckqueue.StopWorkerThreads();
 }
 
+BOOST_AUTO_TEST_CASE(test_batched_schnorr_checks)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTxOut> spent_outputs;
+    CMutableTransaction mtx = BuildTaprootKeyPathSpend(key, 10, spent_outputs);
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+
+    const auto run_checks = [&](const CTransaction& tx, std::vector<CScriptCheck>& checks, PrecomputedTransactionData& txdata) {
+        txdata.Init(tx, std::vector<CTxOut>(spent_outputs));
+        for (unsigned int i = 0; i < tx.vin.size(); ++i) {
+            checks.emplace_back(spent_outputs[i], tx, i, flags, false, &txdata);
+        }
+        return RunChecks(checks);
+    };
+
+    {
+        const CTransaction tx{mtx};
+        PrecomputedTransactionData txdata;
+        std::vector<CScriptCheck> checks;
+        BOOST_CHECK(run_checks(tx, checks, txdata));
+    }
+
+    // An invalid signature fails the batch, and the error is attributed to its input.
+    mtx.vin[6].scriptWitness.stack[0][10] ^= 1;
+    const CTransaction tx{mtx};
+    PrecomputedTransactionData txdata;
+    std::vector<CScriptCheck> checks;
+    BOOST_CHECK(!run_checks(tx, checks, txdata));
+    BOOST_CHECK_EQUAL(checks[6].GetScriptError(), SCRIPT_ERR_SCHNORR_SIG);
+    for (unsigned int i = 0; i < 6; ++i) {
+        BOOST_CHECK_EQUAL(checks[i].GetScriptError(), SCRIPT_ERR_OK);
+    }
+}
+
 SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutableTransaction& input2, const CTransactionRef tx)
 {
     SignatureData sigdata;
@@ -2,12 +2,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
+#include <coins.h>
 #include <consensus/validation.h>
 #include <key.h>
+#include <policy/policy.h>
+#include <script/sigcache.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
+#include <test/util/transaction_utils.h>
 #include <txmempool.h>
 #include <validation.h>
 
@@ -374,4 +380,88 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(persist_caches, BasicTestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTxOut> spent_outputs;
+    const CTransaction tx{BuildTaprootKeyPathSpend(key, 10, spent_outputs)};
+    CCoinsView coins_dummy;
+    CCoinsViewCache coins(&coins_dummy);
+    for (size_t i = 0; i < tx.vin.size(); ++i) {
+        coins.AddCoin(tx.vin[i].prevout, Coin(spent_outputs[i], 1, false), false);
+    }
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+    const fs::path sigcache_path = m_path_root / "sigcache.dat";
+    const fs::path scriptcache_path = m_path_root / "scriptcache.dat";
+
+    // Returns the number of script checks CheckInputScripts leaves after the
+    // script execution cache, and the signature cache hits when running them,
+    // as when connecting a block.
+    const auto check_inputs = [&] {
+        LOCK(cs_main);
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        std::vector<CScriptCheck> checks;
+        BOOST_CHECK(CheckInputScripts(tx, state, coins, flags, false, false, txdata, &checks));
+        const uint64_t hits_before = GetSignatureCacheStats().hits;
+        for (CScriptCheck& check : checks) BOOST_CHECK(check());
+        return std::make_pair(checks.size(), GetSignatureCacheStats().hits - hits_before);
+    };
+
+    // Nothing to dump before the caches were used
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    BOOST_CHECK(!DumpSignatureCache(sigcache_path));
+    BOOST_CHECK(!DumpScriptExecutionCache(scriptcache_path));
+    BOOST_CHECK(!LoadSignatureCache(sigcache_path));
+    BOOST_CHECK(!LoadScriptExecutionCache(scriptcache_path));
+
+    // Accepting the transaction to the mempool fills both caches
+    {
+        LOCK(cs_main);
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        BOOST_CHECK(CheckInputScripts(tx, state, coins, flags, true, true, txdata, nullptr));
+    }
+    BOOST_CHECK(DumpSignatureCache(sigcache_path));
+    BOOST_CHECK(DumpScriptExecutionCache(scriptcache_path));
+
+    // After a restart without persistence every input is verified again
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    BOOST_CHECK(check_inputs() == std::make_pair(tx.vin.size(), uint64_t{0}));
+
+    // With the signature cache restored, the signatures are not verified again.
+    // The dump is deleted once loaded.
+    BOOST_CHECK(LoadSignatureCache(sigcache_path));
+    BOOST_CHECK(!fs::exists(sigcache_path));
+    BOOST_CHECK(check_inputs() == std::make_pair(tx.vin.size(), uint64_t{tx.vin.size()}));
+
+    // With the script execution cache restored too, no script runs at all
+    BOOST_CHECK(LoadScriptExecutionCache(scriptcache_path));
+    BOOST_CHECK(!fs::exists(scriptcache_path));
+    BOOST_CHECK(check_inputs() == std::make_pair(size_t{0}, uint64_t{0}));
+
+    // A truncated dump is rejected and leaves the cache alone
+    BOOST_CHECK(DumpSaltedCache(sigcache_path, uint256::ONE, {uint256::ONE}));
+    fs::resize_file(sigcache_path, fs::file_size(sigcache_path) / 2);
+    BOOST_CHECK(!LoadSignatureCache(sigcache_path));
+
+    // So is a dump written by another client version, or with other script verification flags
+    const auto write_dump = [&](int client_version, unsigned int dump_flags) {
+        CAutoFile file(fsbridge::fopen(sigcache_path, "wb"), SER_DISK, CLIENT_VERSION);
+        file << uint64_t{2} << client_version << dump_flags << uint256::ONE << std::vector<uint256>{uint256::ONE};
+    };
+    uint256 nonce;
+    std::vector<uint256> entries;
+    write_dump(CLIENT_VERSION, STANDARD_SCRIPT_VERIFY_FLAGS);
+    BOOST_CHECK(LoadSaltedCache(sigcache_path, nonce, entries));
+    BOOST_CHECK(nonce == uint256::ONE && entries.size() == 1);
+    write_dump(CLIENT_VERSION - 1, STANDARD_SCRIPT_VERIFY_FLAGS);
+    BOOST_CHECK(!LoadSaltedCache(sigcache_path, nonce, entries));
+    write_dump(CLIENT_VERSION, STANDARD_SCRIPT_VERIFY_FLAGS & ~SCRIPT_VERIFY_TAPROOT);
+    BOOST_CHECK(!LoadSaltedCache(sigcache_path, nonce, entries));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -14,25 +14,42 @@
 #include <cassert>
 #include <cstring>
 #include <string>
+#include <vector>
 
 struct ConnmanTestMsg : public CConnman {
     using CConnman::CConnman;
     void AddTestNode(CNode& node)
     {
+        RegisterNodeSocket(node);
         LOCK(cs_vNodes);
         vNodes.push_back(&node);
     }
     void ClearTestNodes()
     {
-        LOCK(cs_vNodes);
-        for (CNode* node : vNodes) {
+        std::vector<CNode*> nodes;
+        WITH_LOCK(cs_vNodes, nodes.swap(vNodes));
+        for (CNode* node : nodes) {
+#ifdef USE_EPOLL
+            // Drop the events the socket handler kept for the node, and the reference they held
+            if (GetSocketShard(*node).events.erase(node)) node->Release();
+#endif
+            // Closing the socket removes it from epoll before its descriptor can be reused
+            node->CloseSocketDisconnect();
+            const bool unregistered{UnregisterNodeSocket(*node)};
+            assert(unregistered);
             delete node;
         }
-        vNodes.clear();
     }
 
     void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
 
+    void SocketHandlerOnce()
+    {
+        for (const auto& shard : m_socket_shards) {
+            SocketHandler(*shard);
+        }
+    }
+
     void NodeReceiveMsgBytes(CNode& node, Span<const uint8_t> msg_bytes, bool& complete) const;
 
     bool ReceiveMsgFrom(CNode& node, CSerializedNetMsg& ser_msg) const;
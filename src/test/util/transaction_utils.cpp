@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <coins.h>
+#include <key.h>
+#include <script/interpreter.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
@@ -69,3 +71,37 @@ std::vector<CMutableTransaction> SetupDummyInputs(FillableSigningProvider& keyst
 
     return dummyTransactions;
 }
+
+CMutableTransaction BuildTaprootKeyPathSpend(const CKey& key, size_t n_inputs, std::vector<CTxOut>& spent_outputs)
+{
+    return BuildTaprootKeyPathSpend(std::vector<CKey>(n_inputs, key), spent_outputs);
+}
+
+CMutableTransaction BuildTaprootKeyPathSpend(const std::vector<CKey>& keys, std::vector<CTxOut>& spent_outputs)
+{
+    const size_t n_inputs = keys.size();
+    CMutableTransaction tx;
+    spent_outputs.clear();
+    for (size_t i = 0; i < n_inputs; ++i) {
+        const XOnlyPubKey output_key = XOnlyPubKey(keys[i].GetPubKey()).CreateTapTweak(nullptr)->first;
+        tx.vin.emplace_back(COutPoint(uint256::ONE, i));
+        spent_outputs.emplace_back(1000, CScript() << OP_1 << ToByteVector(output_key));
+    }
+    tx.vout.emplace_back(1000 * n_inputs, CScript() << OP_TRUE);
+
+    PrecomputedTransactionData txdata;
+    // Force the Taproot precomputation, as the inputs don't have witnesses yet.
+    txdata.Init(tx, std::vector<CTxOut>(spent_outputs), /* force */ true);
+    ScriptExecutionData execdata;
+    execdata.m_annex_init = true;
+    execdata.m_annex_present = false;
+    const uint256 merkle_root;
+    for (size_t i = 0; i < n_inputs; ++i) {
+        uint256 hash;
+        assert(SignatureHashSchnorr(hash, execdata, tx, i, SIGHASH_DEFAULT, SigVersion::TAPROOT, txdata, MissingDataBehavior::FAIL));
+        std::vector<unsigned char> sig(64);
+        assert(keys[i].SignSchnorr(hash, sig, &merkle_root));
+        tx.vin[i].scriptWitness.stack = {sig};
+    }
+    return tx;
+}
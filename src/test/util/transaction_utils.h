@@ -9,6 +9,7 @@
 
 #include <array>
 
+class CKey;
 class FillableSigningProvider;
 class CCoinsViewCache;
 
@@ -26,4 +27,11 @@ CMutableTransaction BuildSpendingTransaction(const CScript& scriptSig, const CSc
 // the second nValues[2] and nValues[3] outputs paid to a TxoutType::PUBKEYHASH.
 std::vector<CMutableTransaction> SetupDummyInputs(FillableSigningProvider& keystoreRet, CCoinsViewCache& coinsRet, const std::array<CAmount,4>& nValues);
 
+// Helper: create a transaction spending n_inputs Taproot outputs of key through the
+// key path, with 1000 satoshis each. The spent outputs are returned in spent_outputs.
+CMutableTransaction BuildTaprootKeyPathSpend(const CKey& key, size_t n_inputs, std::vector<CTxOut>& spent_outputs);
+
+// Helper: the same, with one input for each of keys.
+CMutableTransaction BuildTaprootKeyPathSpend(const std::vector<CKey>& keys, std::vector<CTxOut>& spent_outputs);
+
 #endif // BITCOINDX_TEST_UTIL_TRANSACTION_UTILS_H
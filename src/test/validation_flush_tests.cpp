@@ -2,6 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
+#include <coins.h>
+#include <memusage.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
 #include <txmempool.h>
@@ -55,89 +57,66 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     constexpr size_t MAX_COINS_CACHE_BYTES = 1024;
 
     // Without any coins in the cache, we shouldn't need to flush.
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), 0U);
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
         CoinsCacheSizeState::OK);
 
-    // If the initial memory allocations of cacheCoins don't match these common
-    // cases, we can't really continue to make assertions about memory usage.
-    // End the test early.
-    if (view.DynamicMemoryUsage() != 32 && view.DynamicMemoryUsage() != 16) {
-        // Add a bunch of coins to see that we at least flip over to CRITICAL.
-
-        for (int i{0}; i < 1000; ++i) {
-            COutPoint res = add_coin(view);
-            BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        }
-
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
-            CoinsCacheSizeState::CRITICAL);
-
-        BOOST_TEST_MESSAGE("Exiting cache flush tests early due to unsupported arch");
-        return;
-    }
-
+    // The first coin allocates the smallest bucket table and a chunk of nodes,
+    // which already exceeds the tiny limit.
+    COutPoint first = add_coin(view);
     print_view_mem_usage(view);
-    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), is_64_bit ? 32U : 16U);
+    BOOST_CHECK_EQUAL(view.AccessCoin(first).DynamicMemoryUsage(), COIN_SIZE);
+    const size_t map_usage{
+        memusage::MallocUsage(16 * sizeof(void*)) +
+        memusage::MallocUsage(16) +
+        memusage::MallocUsage(CCoinsMap::CHUNK_BYTES) +
+        memusage::MallocUsage(sizeof(void*))};
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), map_usage + COIN_SIZE);
+    BOOST_CHECK_EQUAL(
+        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
+        CoinsCacheSizeState::CRITICAL);
 
-    // We should be able to add COINS_UNTIL_CRITICAL coins to the cache before going CRITICAL.
-    // This is contingent not only on the dynamic memory usage of the Coins
-    // that we're adding (COIN_SIZE bytes per), but also on how much memory the
-    // cacheCoins (unordered_map) preallocates.
+    // Further coins fit into the table and the chunk, so that each of them only
+    // adds its own memory usage. Leave room for COINS_UNTIL_CRITICAL of them.
     constexpr int COINS_UNTIL_CRITICAL{3};
+    const size_t max_coins_cache_bytes{view.DynamicMemoryUsage() + COINS_UNTIL_CRITICAL * COIN_SIZE};
 
     for (int i{0}; i < COINS_UNTIL_CRITICAL; ++i) {
         COutPoint res = add_coin(view);
         print_view_mem_usage(view);
         BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
-            CoinsCacheSizeState::OK);
-    }
-
-    // Adding some additional coins will push us over the edge to CRITICAL.
-    for (int i{0}; i < 4; ++i) {
-        add_coin(view);
-        print_view_mem_usage(view);
-        if (chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0) ==
-            CoinsCacheSizeState::CRITICAL) {
-            break;
-        }
+        BOOST_CHECK(
+            chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, /*max_mempool_size_bytes*/ 0) !=
+            CoinsCacheSizeState::CRITICAL);
     }
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), max_coins_cache_bytes);
 
+    // Adding another coin will push us over the edge to CRITICAL.
+    add_coin(view);
+    print_view_mem_usage(view);
     BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
+        chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, /*max_mempool_size_bytes*/ 0),
         CoinsCacheSizeState::CRITICAL);
 
     // Passing non-zero max mempool usage should allow us more headroom.
+    const size_t max_mempool_bytes{view.DynamicMemoryUsage()};
     BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 1 << 10),
+        chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, max_mempool_bytes),
         CoinsCacheSizeState::OK);
 
-    for (int i{0}; i < 3; ++i) {
+    // Adding more coins with the additional mempool room will eventually put
+    // us >90%, but not yet critical.
+    for (int i{0}; i < 100; ++i) {
+        if (chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, max_mempool_bytes) != CoinsCacheSizeState::OK) {
+            break;
+        }
         add_coin(view);
         print_view_mem_usage(view);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 1 << 10),
-            CoinsCacheSizeState::OK);
-    }
-
-    // Adding another coin with the additional mempool room will put us >90%
-    // but not yet critical.
-    add_coin(view);
-    print_view_mem_usage(view);
-
-    // Only perform these checks on 64 bit hosts; I haven't done the math for 32.
-    if (is_64_bit) {
-        float usage_percentage = (float)view.DynamicMemoryUsage() / (MAX_COINS_CACHE_BYTES + (1 << 10));
-        BOOST_TEST_MESSAGE("CoinsTip usage percentage: " << usage_percentage);
-        BOOST_CHECK(usage_percentage >= 0.9);
-        BOOST_CHECK(usage_percentage < 1);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 1 << 10),
-            CoinsCacheSizeState::LARGE);
     }
+    BOOST_CHECK_EQUAL(
+        chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, max_mempool_bytes),
+        CoinsCacheSizeState::LARGE);
 
     // Using the default max_* values permits way more coins to be added.
     for (int i{0}; i < 1000; ++i) {
@@ -147,17 +126,22 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::OK);
     }
 
-    // Flushing the view doesn't take us back to OK because cacheCoins has
-    // preallocated memory that doesn't get reclaimed even after flush.
-
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
         CoinsCacheSizeState::CRITICAL);
 
+    // Flushing the view doesn't take us back to OK because cacheCoins keeps its
+    // bucket table, and its node chunks are kept in the chunk pool for reuse.
     view.SetBestBlock(InsecureRand256());
     BOOST_CHECK(view.Flush());
     print_view_mem_usage(view);
+    BOOST_CHECK_EQUAL(
+        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
+        CoinsCacheSizeState::CRITICAL);
 
+    // Neither does reallocating the map, as the pool still holds the chunks.
+    view.ReallocateCache();
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), 0U);
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
         CoinsCacheSizeState::CRITICAL);
@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <clientversion.h>
 #include <net.h>
 #include <signet.h>
+#include <streams.h>
 #include <uint256.h>
 #include <validation.h>
 
@@ -143,4 +145,40 @@ BOOST_AUTO_TEST_CASE(test_assumeutxo)
     BOOST_CHECK_EQUAL(out210.nChainTx, 200U);
 }
 
+BOOST_AUTO_TEST_CASE(block_file_scanner)
+{
+    const CChainParams& params = Params();
+    CBlock block1 = params.GenesisBlock();
+    CBlock block2 = block1;
+    block2.nNonce++;
+    const unsigned int size = ::GetSerializeSize(block1, CLIENT_VERSION);
+
+    // Two blocks, with garbage before, between and after them: a stray message
+    // start with an implausible size, and a message start without a block.
+    const fs::path path = m_path_root / "blocks.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        file << uint8_t{0x42};
+        file << params.MessageStart() << size << block1;
+        file << params.MessageStart() << uint32_t{MAX_BLOCK_SERIALIZED_SIZE + 1};
+        file << params.MessageStart() << size << block2;
+        file << params.MessageStart();
+    }
+    const unsigned int header_size = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+
+    BlockFileScanner scanner(fsbridge::fopen(path, "rb"), params, 3);
+    ExternalBlock found;
+    BOOST_REQUIRE(scanner.Next(found));
+    BOOST_CHECK_EQUAL(found.hash, block1.GetHash());
+    BOOST_CHECK_EQUAL(found.block->GetHash(), block1.GetHash());
+    BOOST_CHECK_EQUAL(found.pos.nFile, 3);
+    BOOST_CHECK_EQUAL(found.pos.nPos, 1 + header_size);
+    BOOST_CHECK_EQUAL(found.size, size);
+    BOOST_REQUIRE(scanner.Next(found));
+    BOOST_CHECK_EQUAL(found.hash, block2.GetHash());
+    BOOST_CHECK_EQUAL(found.pos.nPos, 1 + 3 * header_size + size);
+    BOOST_CHECK(!scanner.Next(found));
+    BOOST_CHECK(!scanner.Next(found));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,12 +5,14 @@
 
 #include <txdb.h>
 
+#include <memusage.h>
 #include <node/ui_interface.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
@@ -81,6 +83,10 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    return BatchWrite(mapCoins, hashBlock, /*erase*/ true);
+}
+
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase, bool sync) {
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -116,7 +122,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         }
         count++;
         CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (erase) mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
@@ -136,7 +142,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Write(DB_BEST_BLOCK, hashBlock);
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-    bool ret = m_db->WriteBatch(batch);
+    bool ret = m_db->WriteBatch(batch, sync);
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
 }
@@ -146,6 +152,121 @@ size_t CCoinsViewDB::EstimateSize() const
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
 }
 
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsViewDB& db, bool background) : m_db(db), m_background(background) {}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush()
+{
+    WaitForFlush();
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(m_mutex);
+        if (!m_writing_block.IsNull()) {
+            auto it = m_writing.find(outpoint);
+            if (it != m_writing.end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    return m_db.GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(m_mutex);
+        if (!m_writing_block.IsNull()) {
+            auto it = m_writing.find(outpoint);
+            if (it != m_writing.end()) return !it->second.coin.IsSpent();
+        }
+    }
+    return m_db.HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const {
+    {
+        LOCK(m_mutex);
+        if (!m_writing_block.IsNull()) return m_writing_block;
+    }
+    return m_db.GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewBackgroundFlush::GetHeadBlocks() const { return m_db.GetHeadBlocks(); }
+std::unique_ptr<CCoinsViewCursor> CCoinsViewBackgroundFlush::Cursor() const { return m_db.Cursor(); }
+size_t CCoinsViewBackgroundFlush::EstimateSize() const { return m_db.EstimateSize(); }
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!WaitForFlush()) return false;
+    if (!m_background) return m_db.BatchWrite(mapCoins, hashBlock);
+
+    {
+        LOCK(m_mutex);
+        // The coins of the previous write are on disk, and their chunks go back to the pool here.
+        m_writing = std::move(mapCoins);
+        m_writing_block = hashBlock;
+    }
+    m_writing_usage = memusage::DynamicUsage(m_writing);
+    for (const auto& entry : m_writing) m_writing_usage += entry.second.coin.DynamicMemoryUsage();
+    m_writer = std::thread(&util::TraceThread, "coinsflush", [this, hashBlock] {
+        bool ret{false};
+        try {
+            ret = m_db.BatchWrite(m_writing, hashBlock, /*erase*/ false, /*sync*/ true);
+        } catch (const std::exception& e) {
+            LogPrintf("Error writing coins in the background: %s\n", e.what());
+        }
+        if (!ret) {
+            // Keep serving the coins, which are not in the database, until the node shuts down
+            WITH_LOCK(m_mutex, m_write_failed = true; m_on_written = nullptr);
+            AbortNode("Failed to write to coin database");
+            return;
+        }
+        std::function<void()> on_written;
+        {
+            LOCK(m_mutex);
+            m_writing_block.SetNull();
+            on_written = std::move(m_on_written);
+            m_on_written = nullptr;
+        }
+        if (on_written) on_written();
+    });
+    return true;
+}
+
+bool CCoinsViewBackgroundFlush::WaitForFlush()
+{
+    if (m_writer.joinable()) m_writer.join();
+    LOCK(m_mutex);
+    return !m_write_failed;
+}
+
+void CCoinsViewBackgroundFlush::ReleaseWritten()
+{
+    {
+        LOCK(m_mutex);
+        // A write in progress still reads the coins, and a failed one keeps serving them
+        if (!m_writing_block.IsNull() || m_write_failed) return;
+    }
+    if (m_writer.joinable()) m_writer.join();
+    if (m_writing_usage == 0) return;
+    // Assigning an empty map frees the table as well as handing the chunks back
+    m_writing = CCoinsMap{m_writing.chunk_pool()};
+    m_writing_usage = 0;
+}
+
+void CCoinsViewBackgroundFlush::OnWritten(std::function<void()> fn)
+{
+    {
+        LOCK(m_mutex);
+        if (m_write_failed) return;
+        if (!m_writing_block.IsNull()) {
+            m_on_written = std::move(fn);
+            return;
+        }
+    }
+    fn();
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -11,8 +11,12 @@
 #include <chain.h>
 #include <primitives/block.h>
 
+#include <sync.h>
+
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -36,6 +40,8 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! -backgroundflush default
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -60,6 +66,9 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Write the coins like BatchWrite does, but only erase them from mapCoins if erase is set,
+    //! and only return once the last batch is synced to disk if sync is set.
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase, bool sync = false);
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
@@ -70,6 +79,82 @@ public:
     void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 };
 
+/**
+ * CCoinsView on top of the coin database that can write flushed coins on a
+ * background thread, so that the flushing thread (which holds cs_main) does
+ * not have to wait for the database write.
+ *
+ * In background mode, BatchWrite takes over the coins to write and returns
+ * right away. Until the write completes, lookups are answered from those coins
+ * before the database, and GetBestBlock returns the block being written. The
+ * database stays crash consistent as with a synchronous write, since it is
+ * marked as being in transition to the new best block (see GetHeadBlocks)
+ * until its last batch was written. A BatchWrite while a write is still in
+ * progress first waits for it, so that there is at most one pending write.
+ * A background write syncs its last batch, and callbacks registered with
+ * OnWritten only run after that.
+ *
+ * If a background write fails, the node is shut down with AbortNode, and the
+ * coins that were being written keep being served from memory, as they did
+ * not reach the database. Later writes fail.
+ *
+ * BatchWrite and WaitForFlush must not be called concurrently. Lookups may be
+ * performed from any thread.
+ */
+class CCoinsViewBackgroundFlush final : public CCoinsView
+{
+private:
+    CCoinsViewDB& m_db;
+    const bool m_background;
+
+    mutable Mutex m_mutex;
+    //! The coins being written by m_writer. Not modified until it is done, so
+    //! that it can read them without holding m_mutex. Kept after the write until
+    //! ReleaseWritten() or the next BatchWrite, which give its chunks back to the
+    //! pool of the map it was moved from on the thread that owns that pool.
+    CCoinsMap m_writing;
+    //! Memory held by m_writing, including the coins' scripts. Only accessed by
+    //! the thread calling BatchWrite.
+    size_t m_writing_usage{0};
+    //! The best block of the write in progress, null if there is none.
+    uint256 m_writing_block GUARDED_BY(m_mutex);
+    bool m_write_failed GUARDED_BY(m_mutex){false};
+    //! Called once the write in progress is on disk
+    std::function<void()> m_on_written GUARDED_BY(m_mutex);
+    std::thread m_writer;
+
+public:
+    CCoinsViewBackgroundFlush(CCoinsViewDB& db, bool background);
+    ~CCoinsViewBackgroundFlush() override;
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    std::vector<uint256> GetHeadBlocks() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    size_t EstimateSize() const override;
+
+    //! Whether BatchWrite writes on a background thread.
+    bool IsBackground() const { return m_background; }
+
+    //! Memory held by the coins passed to the last BatchWrite, until they are released.
+    size_t DynamicMemoryUsage() const { return m_writing_usage; }
+
+    //! If the write in progress is done, release the coins it wrote. Must be called
+    //! from the thread calling BatchWrite, as it returns their chunks to its pool.
+    void ReleaseWritten();
+
+    //! Wait until the write in progress, if any, is complete. Returns false if it or an
+    //! earlier write failed.
+    bool WaitForFlush();
+
+    //! Call fn once the coins passed to the last BatchWrite are on disk: right away if they
+    //! already are, or on the writer thread when the background write completes. fn is not
+    //! called if the write fails.
+    void OnWritten(std::function<void()> fn);
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
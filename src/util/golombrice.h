@@ -5,8 +5,11 @@
 #ifndef BITCOINDX_UTIL_GOLOMBRICE_H
 #define BITCOINDX_UTIL_GOLOMBRICE_H
 
+#include <crypto/common.h>
+#include <span.h>
 #include <streams.h>
 
+#include <algorithm>
 #include <cstdint>
 
 template <typename OStream>
@@ -40,4 +43,88 @@ uint64_t GolombRiceDecode(BitStreamReader<IStream>& bitreader, uint8_t P)
     return (q << P) + r;
 }
 
+/**
+ * Decodes Golomb-Rice coded values from a byte span, keeping up to 63 unread
+ * bits in a word that is refilled 8 bytes at a time. The unary quotient of a
+ * value is counted with one leading-zeros instruction instead of being read bit
+ * by bit as GolombRiceDecode does, which it otherwise matches bit for bit.
+ */
+class GolombRiceReader
+{
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+    /** Number of bytes loaded into m_buffer */
+    size_t m_pos{0};
+    /** Unread bits, most significant first. The bits below the m_bits valid
+     *  ones are either zero or copies of the bytes that follow. */
+    uint64_t m_buffer{0};
+    int m_bits{0};
+
+    void Refill()
+    {
+        if (m_size - m_pos >= 8) {
+            m_buffer |= ReadBE64(m_data + m_pos) >> m_bits;
+            m_pos += (63 - m_bits) >> 3;
+            m_bits |= 56;
+        } else {
+            while (m_bits <= 55 && m_pos < m_size) {
+                m_buffer |= uint64_t{m_data[m_pos++]} << (56 - m_bits);
+                m_bits += 8;
+            }
+        }
+    }
+
+    void Consume(int nbits)
+    {
+        m_buffer <<= nbits;
+        m_bits -= nbits;
+    }
+
+public:
+    explicit GolombRiceReader(Span<const unsigned char> data) : m_data(data.data()), m_size(data.size()) {}
+
+    /** Decode the next value. Returns false if the data ends before it does. */
+    bool Decode(uint8_t P, uint64_t& value)
+    {
+        uint64_t q = 0;
+        while (true) {
+            if (m_bits < 56) Refill();
+            if (m_bits == 0) return false;
+            const int ones = 64 - static_cast<int>(CountBits(~m_buffer));
+            if (ones < m_bits) {
+                q += ones;
+                Consume(ones + 1);
+                break;
+            }
+            q += m_bits;
+            Consume(m_bits);
+        }
+
+        uint64_t r = 0;
+        if (m_bits < P) Refill();
+        if (m_bits >= P) {
+            if (P > 0) {
+                r = m_buffer >> (64 - P);
+                Consume(P);
+            }
+        } else {
+            // Only for P > 56, which does not fit in a refilled buffer
+            for (int left = P; left > 0;) {
+                Refill();
+                if (m_bits == 0) return false;
+                const int nbits = std::min(left, m_bits);
+                r = (r << nbits) | (m_buffer >> (64 - nbits));
+                Consume(nbits);
+                left -= nbits;
+            }
+        }
+        value = (q << P) + r;
+        return true;
+    }
+
+    /** Number of bits decoded so far. */
+    uint64_t BitsRead() const { return uint64_t{m_pos} * 8 - m_bits; }
+};
+
 #endif // BITCOINDX_UTIL_GOLOMBRICE_H
@@ -76,6 +76,16 @@ public:
     }
 };
 
+/**
+ * Picks the shard of a signature cache entry (see CuckooCache::sharded_cache)
+ * from its first byte. The entries are salted hashes, and SignatureCacheHasher
+ * places them by the high bits of their 32-bit words, so this doesn't skew
+ * where they go within a shard.
+ */
+struct SignatureCacheShardHasher {
+    size_t operator()(const uint256& key) const { return *key.begin(); }
+};
+
 struct BlockHasher
 {
     // this used to call `GetCheapHash()` in uint256, which was later moved; the
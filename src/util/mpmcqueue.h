@@ -0,0 +1,113 @@
+// Copyright (c) 2022 The BitcoinDX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOINDX_UTIL_MPMCQUEUE_H
+#define BITCOINDX_UTIL_MPMCQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded multi-producer multi-consumer FIFO queue that does not take any
+ * lock, after D. Vyukov's bounded MPMC queue. Every slot carries a sequence
+ * number that tells the producer or consumer which claimed its position
+ * whether the slot is ready for it, so pushing and popping only contend on one
+ * atomic position counter each. A slot is free for position `pos` if its
+ * sequence number is 2 * pos, and holds the item pushed there if it is
+ * 2 * pos + 1, which unlike the original encoding also works for a capacity
+ * of 1.
+ *
+ * TryPush and TryPop never block. Callers that need to wait for room or for
+ * items must do so themselves. An item pushed by one thread may not be
+ * visible to TryPop yet while a push to an earlier position is still in
+ * progress on another thread.
+ */
+template <typename T>
+class MPMCQueue
+{
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        T value;
+    };
+
+    const size_t m_capacity;
+    const std::unique_ptr<Slot[]> m_slots;
+    // Keep the position counters on separate cache lines
+    alignas(64) std::atomic<uint64_t> m_push_pos{0};
+    alignas(64) std::atomic<uint64_t> m_pop_pos{0};
+
+public:
+    explicit MPMCQueue(size_t capacity) : m_capacity(capacity), m_slots(new Slot[capacity])
+    {
+        assert(capacity > 0);
+        for (size_t i = 0; i < capacity; ++i) {
+            m_slots[i].seq.store(2 * i, std::memory_order_relaxed);
+        }
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    /** Append an item. Returns false, leaving `value` untouched, if the queue is full. */
+    bool TryPush(T&& value)
+    {
+        uint64_t pos = m_push_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos % m_capacity];
+            const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq == 2 * pos) {
+                if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.seq.store(2 * pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < 2 * pos) {
+                // The slot still holds the item pushed one round earlier
+                return false;
+            } else {
+                pos = m_push_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Remove the oldest item. Returns false if the queue is empty. */
+    bool TryPop(T& value)
+    {
+        uint64_t pos = m_pop_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = m_slots[pos % m_capacity];
+            const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq == 2 * pos + 1) {
+                if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(slot.value);
+                    slot.value = T{};
+                    slot.seq.store(2 * (pos + m_capacity), std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < 2 * pos + 1) {
+                // Nothing was pushed to this position yet
+                return false;
+            } else {
+                pos = m_pop_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t Capacity() const { return m_capacity; }
+
+    /** Number of items in the queue; only a snapshot while other threads use it. */
+    size_t Size() const
+    {
+        const uint64_t pop_pos = m_pop_pos.load(std::memory_order_relaxed);
+        const uint64_t push_pos = m_push_pos.load(std::memory_order_relaxed);
+        return push_pos > pop_pos ? push_pos - pop_pos : 0;
+    }
+};
+
+#endif // BITCOINDX_UTIL_MPMCQUEUE_H
@@ -55,6 +55,7 @@
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -1205,11 +1206,12 @@ CoinsViews::CoinsViews(
     bool in_memory,
     bool should_wipe) : m_dbview(
                             gArgs.GetDataDirNet() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                        m_flushview(m_dbview, gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH)),
+                        m_catcherview(&m_flushview) {}
 
 void CoinsViews::InitCache()
 {
-    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview, &m_chunk_pool);
 }
 
 CChainState::CChainState(CTxMemPool* mempool, BlockManager& blockman, std::optional<uint256> from_snapshot_blockhash)
@@ -1364,6 +1366,76 @@ bool CScriptCheck::operator()() {
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
 }
 
+bool CScriptCheck::operator()(SchnorrBatch& batch) {
+    // Signatures that end up in the signature cache have to be verified right away.
+    if (cacheStore) return (*this)();
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, *txdata, batch), &error);
+}
+
+bool RunChecks(std::vector<CScriptCheck>& checks)
+{
+    SchnorrBatch batch;
+    std::vector<CScriptCheck*> batched;
+    for (CScriptCheck& check : checks) {
+        const size_t batch_size = batch.size();
+        if (!check(batch)) return false;
+        if (batch.size() > batch_size) batched.push_back(&check);
+    }
+    if (batch.Verify()) return true;
+    for (CScriptCheck* check : batched) {
+        if (!(*check)()) return false;
+    }
+    return true;
+}
+
+bool CCoinsPrefetchCheck::operator()() {
+    if (!m_view->GetCoin(m_outpoint, *m_coin)) {
+        m_coin->Clear();
+    }
+    return true;
+}
+
+size_t PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base, CCheckQueue<CCoinsPrefetchCheck>& queue)
+{
+    // Outputs created within the block itself are never in the backing view.
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash) || cache.HaveCoinInCache(txin.prevout)) continue;
+            outpoints.push_back(txin.prevout);
+        }
+    }
+    if (outpoints.empty()) return 0;
+
+    // The checks write into coins, which must therefore not be resized until they completed.
+    std::vector<Coin> coins(outpoints.size());
+    std::vector<CCoinsPrefetchCheck> checks;
+    checks.reserve(outpoints.size());
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        checks.emplace_back(base, outpoints[i], coins[i]);
+    }
+    {
+        CCheckQueueControl<CCoinsPrefetchCheck> control(&queue);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    size_t loaded = 0;
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (!coins[i].IsSpent() && cache.EmplacePrefetchedCoin(outpoints[i], std::move(coins[i]))) ++loaded;
+    }
+    return loaded;
+}
+
 int BlockManager::GetSpendHeight(const CCoinsViewCache& inputs)
 {
     AssertLockHeld(cs_main);
@@ -1374,15 +1446,22 @@ int BlockManager::GetSpendHeight(const CCoinsViewCache& inputs)
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
 static CSHA256 g_scriptExecutionCacheHasher;
+static uint256 g_scriptExecutionCacheNonce;
 
-void InitScriptExecutionCache() {
-    // Setup the salted hasher
-    uint256 nonce = GetRandHash();
+static void SetScriptExecutionCacheNonce(const uint256& nonce)
+{
+    g_scriptExecutionCacheNonce = nonce;
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy twice to fill the 64 bytes.
+    g_scriptExecutionCacheHasher = CSHA256();
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
+}
+
+void InitScriptExecutionCache() {
+    // Setup the salted hasher
+    SetScriptExecutionCacheNonce(GetRandHash());
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
@@ -1391,6 +1470,29 @@ void InitScriptExecutionCache() {
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+bool DumpScriptExecutionCache(const fs::path& path)
+{
+    std::vector<uint256> entries;
+    g_scriptExecutionCache.for_each([&entries](const uint256& entry) { entries.push_back(entry); });
+    if (entries.empty()) return false;
+    if (!DumpSaltedCache(path, g_scriptExecutionCacheNonce, entries)) return false;
+    LogPrintf("Dumped %u script execution cache entries\n", entries.size());
+    return true;
+}
+
+bool LoadScriptExecutionCache(const fs::path& path)
+{
+    uint256 nonce;
+    std::vector<uint256> entries;
+    if (!LoadSaltedCache(path, nonce, entries)) return false;
+    SetScriptExecutionCacheNonce(nonce);
+    for (const uint256& entry : entries) {
+        g_scriptExecutionCache.insert(entry);
+    }
+    LogPrintf("Loaded %u script execution cache entries from disk\n", entries.size());
+    return true;
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1599,15 +1701,18 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 }
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CCoinsPrefetchCheck> coinsprefetchqueue(128);
 
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    coinsprefetchqueue.StartWorkerThreads(threads_num, "coinsfetch");
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    coinsprefetchqueue.StopWorkerThreads();
 }
 
 /**
@@ -2017,7 +2122,17 @@ CoinsCacheSizeState CChainState::GetCoinsCacheSizeState(
     size_t max_mempool_size_bytes)
 {
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // Chunks kept in the pool for reuse, and coins that are still being written in
+    // the background, are memory held on behalf of the coins cache too.
+    const CCoinsViewBackgroundFlush& flush_view = m_coins_views->m_flushview;
+    const size_t writing_usage{flush_view.DynamicMemoryUsage()};
+    int64_t cacheSize = CoinsTip().DynamicMemoryUsage() +
+        memusage::MallocUsage(CCoinsMap::CHUNK_BYTES) * m_coins_views->m_chunk_pool.chunk_count() +
+        writing_usage;
+    // Once flushed in the background, the coins stay in memory while the cache fills up
+    // again. Unless a write is already in progress, keep as much room for that, so that
+    // the cache is flushed at half the size and the next flush rarely has to wait.
+    if (flush_view.IsBackground() && writing_usage == 0) cacheSize += CoinsTip().DynamicMemoryUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(max_mempool_size_bytes - nMempoolUsage, 0);
 
@@ -2049,6 +2164,8 @@ bool CChainState::FlushStateToDisk(
 
     const size_t coins_count = CoinsTip().GetCacheSize();
     const size_t coins_mem_usage = CoinsTip().DynamicMemoryUsage();
+    // Stop counting the coins of a finished background write against the cache size
+    m_coins_views->m_flushview.ReleaseWritten();
 
     try {
     {
@@ -2138,6 +2255,10 @@ bool CChainState::FlushStateToDisk(
             if (fFlushForPrune) {
                 LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
 
+                // Don't remove blocks that a coins write still in progress may need to be replayed from.
+                if (!m_coins_views->m_flushview.WaitForFlush()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
                 UnlinkPrunedFiles(setFilesToPrune);
             }
             nLastWrite = nNow;
@@ -2158,13 +2279,21 @@ bool CChainState::FlushStateToDisk(
             // Flush the chainstate (which may refer to block index entries).
             if (!CoinsTip().Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // With -backgroundflush, the coins may still be being written. Callers
+            // asking for a flush expect the database to be up to date afterwards.
+            if (mode == FlushStateMode::ALWAYS && !m_coins_views->m_flushview.WaitForFlush()) {
+                return AbortNode(state, "Failed to write to coin database");
+            }
             nLastFlush = nNow;
             full_flush_completed = true;
         }
     }
     if (full_flush_completed) {
-        // Update best block in wallet (so we can detect restored wallets).
-        GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
+        // Update best block in wallet (so we can detect restored wallets), once the
+        // coins are on disk, which with -backgroundflush may be after returning.
+        m_coins_views->m_flushview.OnWritten([locator = m_chain.GetLocator()] {
+            GetMainSignals().ChainStateFlushed(locator);
+        });
     }
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error while flushing: ") + e.what());
@@ -2269,7 +2398,7 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
-        CCoinsViewCache view(&CoinsTip());
+        CCoinsViewCache view(&CoinsTip(), &m_coins_views->m_chunk_pool);
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
@@ -2305,6 +2434,7 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2379,8 +2509,16 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    // Warm the coins cache with the block's inputs using the worker threads, rather
+    // than fetching them from the database one at a time while connecting the block.
+    if (g_parallel_script_checks) {
+        const size_t prefetched{PrefetchBlockInputs(blockConnecting, CoinsTip(), m_coins_views->m_catcherview, coinsprefetchqueue)};
+        int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+        LogPrint(BCLog::BENCH, "  - Prefetch %u inputs: %.2fms [%.2fs]\n", prefetched, (nTimePrefetched - nTime2) * MILLI, nTimePrefetch * MICRO);
+        nTime2 = nTimePrefetched;
+    }
     {
-        CCoinsViewCache view(&CoinsTip());
+        CCoinsViewCache view(&CoinsTip(), &m_coins_views->m_chunk_pool);
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
@@ -4159,29 +4297,34 @@ bool CChainState::LoadGenesisBlock()
     return true;
 }
 
-void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
+BlockFileScanner::BlockFileScanner(FILE* fileIn, const CChainParams& chainparams, int nFile)
+    // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+    : m_file{std::make_unique<CBufferedFile>(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION)},
+      m_params{chainparams},
+      m_file_num{nFile}
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+    m_rewind = m_file->GetPos();
+}
 
-    int nLoaded = 0;
+BlockFileScanner::~BlockFileScanner() = default;
+
+bool BlockFileScanner::Next(ExternalBlock& found)
+{
+    if (!m_file) return false;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
+        CBufferedFile& blkdat = *m_file;
         while (!blkdat.eof()) {
-            if (ShutdownRequested()) return;
+            if (ShutdownRequested()) break;
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
+            blkdat.SetPos(m_rewind);
+            m_rewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
             try {
                 // locate a header
                 unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
                 blkdat.FindByte(m_params.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
+                m_rewind = blkdat.GetPos()+1;
                 blkdat >> buf;
                 if (memcmp(buf, m_params.MessageStart(), CMessageHeader::MESSAGE_START_SIZE)) {
                     continue;
@@ -4197,15 +4340,50 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
             try {
                 // read block
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
                 std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
+                blkdat >> *pblock;
+                m_rewind = blkdat.GetPos();
+
+                found.hash = pblock->GetHash();
+                found.block = std::move(pblock);
+                found.pos = FlatFilePos(m_file_num, nBlockPos);
+                found.size = nSize;
+                return true;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    m_file.reset();
+    return false;
+}
+
+void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
+{
+    BlockFileScanner scanner(fileIn, m_params, dbp ? dbp->nFile : -1);
+    LoadExternalBlocks([&scanner](ExternalBlock& block) { return scanner.Next(block); }, dbp != nullptr);
+}
+
+void CChainState::LoadExternalBlocks(const std::function<bool(ExternalBlock&)>& next_block, bool in_block_files)
+{
+    // Map of disk positions for blocks with unknown parent (only used for reindex)
+    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
+    int64_t nStart = GetTimeMillis();
+
+    int nLoaded = 0;
+    try {
+        ExternalBlock external;
+        while (next_block(external)) {
+            if (ShutdownRequested()) return;
 
-                uint256 hash = block.GetHash();
+            try {
+                const std::shared_ptr<const CBlock>& pblock = external.block;
+                const CBlock& block = *pblock;
+                const uint256& hash = external.hash;
+                const FlatFilePos* dbp = in_block_files ? &external.pos : nullptr;
                 {
                     LOCK(cs_main);
                     // detect out of order blocks, and store them for later
@@ -4479,6 +4657,11 @@ bool CChainState::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     size_t old_coinstip_size = m_coinstip_cache_size_bytes;
     m_coinstip_cache_size_bytes = coinstip_size;
     m_coinsdb_cache_size_bytes = coinsdb_size;
+    // The database is reopened, which must not happen while it is being written to.
+    if (!m_coins_views->m_flushview.WaitForFlush()) {
+        BlockValidationState state;
+        return AbortNode(state, "Failed to write to coin database");
+    }
     CoinsDB().ResizeCache(coinsdb_size);
 
     LogPrintf("[%s] resized coinsdb cache to %.1f MiB\n",
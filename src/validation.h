@@ -15,7 +15,9 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <crypto/common.h> // for ReadLE64
+#include <flatfile.h>
 #include <fs.h>
+#include <node/blockcache.h>
 #include <node/utxo_snapshot.h>
 #include <policy/feerate.h>
 #include <policy/packages.h>
@@ -30,6 +32,7 @@
 #include <util/translation.h>
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -45,12 +48,16 @@ class BlockValidationState;
 class CBlockIndex;
 class CBlockTreeDB;
 class CBlockUndo;
+class CBufferedFile;
 class CChainParams;
 struct CCheckpointData;
 class CInv;
 class CConnman;
 class CScriptCheck;
+class SchnorrBatch;
 class CTxMemPool;
+template <typename T>
+class CCheckQueue;
 class ChainstateManager;
 struct ChainTxData;
 
@@ -97,6 +104,8 @@ static const unsigned int DEFAULT_CHECKLEVEL = 3;
 // one 128MB block file + added 15% undo data = 147MB greater for a total of 545MB
 // Setting the target to >= 550 MiB will make it likely we can respect the target.
 static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
+/** Maximum memory kept in the chunk pool of the coins caches for reuse, in bytes */
+static constexpr size_t MAX_COINS_CHUNK_POOL_BYTES{8 * 1024 * 1024};
 
 /** Current sync state passed to tip changed callbacks. */
 enum class SynchronizationState {
@@ -136,9 +145,9 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 
 /** Unload database information */
 void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
-/** Run instances of script checking worker threads */
+/** Run instances of script checking and coins prefetching worker threads */
 void StartScriptCheckWorkerThreads(int threads_num);
-/** Stop all of the script checking worker threads */
+/** Stop all of the script checking and coins prefetching worker threads */
 void StopScriptCheckWorkerThreads();
 /**
  * Return transaction from the block at block_index.
@@ -314,6 +323,12 @@ public:
 
     bool operator()();
 
+    /**
+     * Verify the script, deferring the verification of Schnorr signatures to batch.
+     * The check only passed if the batch verifies as well.
+     */
+    bool operator()(SchnorrBatch& batch);
+
     void swap(CScriptCheck &check) {
         std::swap(ptxTo, check.ptxTo);
         std::swap(m_tx_out, check.m_tx_out);
@@ -327,8 +342,92 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run a chunk of script checks for the check queue, verifying their Schnorr
+ * signatures as one batch. If the batch fails, the checks that contributed to it
+ * are rerun one by one, so the error is attributed to the right input.
+ */
+bool RunChecks(std::vector<CScriptCheck>& checks);
+
+/**
+ * Closure representing the lookup of one spent coin in the backing coins view,
+ * run ahead of ConnectBlock to warm the coins cache (see PrefetchBlockInputs).
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView* m_view{nullptr};
+    COutPoint m_outpoint;
+    Coin* m_coin{nullptr};
+
+public:
+    CCoinsPrefetchCheck() = default;
+    CCoinsPrefetchCheck(const CCoinsView& view, const COutPoint& outpoint, Coin& coin) :
+        m_view(&view), m_outpoint(outpoint), m_coin(&coin) { }
+
+    bool operator()();
+
+    void swap(CCoinsPrefetchCheck& check) {
+        std::swap(m_view, check.m_view);
+        std::swap(m_outpoint, check.m_outpoint);
+        std::swap(m_coin, check.m_coin);
+    }
+};
+
+/**
+ * Load the coins spent by a block into a coins cache before ConnectBlock walks
+ * its inputs, so that validation does not stall on one database read per input.
+ * Coins missing from the cache are looked up in base (the view backing the cache)
+ * on the workers of the given queue, so base must support concurrent reads, as
+ * CCoinsViewDB does.
+ *
+ * @returns the number of coins that were loaded into the cache.
+ */
+size_t PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base, CCheckQueue<CCoinsPrefetchCheck>& queue);
+
+/** A block found in a block file by BlockFileScanner */
+struct ExternalBlock {
+    std::shared_ptr<const CBlock> block;
+    uint256 hash;
+    //! Where the block starts; only meaningful when reading one of our own blk?????.dat files
+    FlatFilePos pos;
+    //! Serialized size of the block
+    unsigned int size{0};
+};
+
+/**
+ * Finds and deserializes the blocks in a block file one by one, in the order they
+ * appear in it, skipping over garbage between them. Needs no locks, so that several
+ * files can be read in parallel, see ThreadImport.
+ */
+class BlockFileScanner
+{
+public:
+    /**
+     * @param[in] fileIn  file to read, which is taken over and closed when done
+     * @param[in] nFile   number of the blk?????.dat file being read, to fill in
+     *                    the positions of the blocks, or -1 for an external file
+     */
+    BlockFileScanner(FILE* fileIn, const CChainParams& chainparams, int nFile = -1);
+    ~BlockFileScanner();
+
+    //! Read the next block. Returns false at the end of the file or on shutdown.
+    bool Next(ExternalBlock& block);
+
+private:
+    std::unique_ptr<CBufferedFile> m_file;
+    const CChainParams& m_params;
+    const int m_file_num;
+    //! Where to look for the next block
+    uint64_t m_rewind{0};
+};
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
+/** Save the script-execution cache with its salt, see DumpSignatureCache */
+bool DumpScriptExecutionCache(const fs::path& path);
+/** Replace the script-execution cache by a saved one, before anything uses it */
+bool LoadScriptExecutionCache(const fs::path& path);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -446,6 +545,9 @@ public:
      */
     std::multimap<CBlockIndex*, CBlockIndex*> m_blocks_unlinked;
 
+    /** Recently served blocks in serialized form, shared by P2P and REST (-blockcachesize) */
+    SerializedBlockCache m_block_cache;
+
     /**
      * Load the blocktree off disk and into memory. Populate certain metadata
      * per index entry (nStatus, nChainWork, nTimeMax, etc.) as well as peripheral
@@ -516,6 +618,17 @@ public:
     //! All unspent coins reside in this store.
     CCoinsViewDB m_dbview GUARDED_BY(cs_main);
 
+    //! Node memory shared by the coins tip cache and the short-lived caches layered
+    //! on top of it to connect or disconnect a block, so that their map nodes are
+    //! reused rather than freed and allocated again for every block. Declared
+    //! before m_flushview and m_cacheview, which return their chunks here when
+    //! they are destroyed.
+    CCoinsMap::ChunkPool m_chunk_pool GUARDED_BY(cs_main){MAX_COINS_CHUNK_POOL_BYTES / CCoinsMap::CHUNK_BYTES};
+
+    //! This view writes flushes of the cache to m_dbview, on a background thread if
+    //! -backgroundflush is set.
+    CCoinsViewBackgroundFlush m_flushview GUARDED_BY(cs_main);
+
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
@@ -683,6 +796,15 @@ public:
     /** Import blocks from an external file */
     void LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp = nullptr);
 
+    /**
+     * Import blocks in the order next_block returns them, until it returns false.
+     *
+     * @param[in] in_block_files  whether the blocks come from our own block files
+     *                            (-reindex), so they are not written again and
+     *                            out of order blocks can be read back later.
+     */
+    void LoadExternalBlocks(const std::function<bool(ExternalBlock&)>& next_block, bool in_block_files);
+
     /**
      * Update the on-disk chain state.
      * The caches and indexes are flushed depending on the mode we're called with
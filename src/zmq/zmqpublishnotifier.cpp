@@ -7,6 +7,8 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <streams.h>
 #include <util/system.h>
@@ -203,21 +205,25 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    std::vector<uint8_t> block_bytes;
     {
+        // Keep the block file from being pruned while it is read
         LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
+        if (RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+                zmqError("Can't read block from disk");
+                return false;
+            }
+            CVectorWriter{SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), block_bytes, 0, block};
+        } else if (!ReadRawBlockFromDisk(block_bytes, pindex, Params().MessageStart())) {
+            // The witness serialization is the format on disk
             zmqError("Can't read block from disk");
             return false;
         }
-
-        ss << block;
     }
 
-    return SendZmqMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendZmqMessage(MSG_RAWBLOCK, block_bytes.data(), block_bytes.size());
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
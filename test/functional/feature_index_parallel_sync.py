@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The BitcoinDX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test building indexes on several threads with -indexthreads."""
+import os
+import shutil
+
+from test_framework.test_framework import BitcoinDXTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+
+class IndexParallelSyncTest(BitcoinDXTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def sync_index(self, height, name='txindex'):
+        expected = {'synced': True, 'best_block_height': height}
+        self.wait_until(lambda: self.nodes[0].getindexinfo(name).get(name) == expected)
+
+    def check_txindex(self):
+        node = self.nodes[0]
+        for height in range(1, node.getblockcount() + 1):
+            block = node.getblock(node.getblockhash(height))
+            for txid in block['tx']:
+                assert_equal(node.getrawtransaction(txid, True)['blockhash'], block['hash'])
+
+    def get_block_filters(self):
+        node = self.nodes[0]
+        return [node.getblockfilter(node.getblockhash(height)) for height in range(node.getblockcount() + 1)]
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node)
+        wallet.generate(101)
+        node.generate(100)
+        self.log.info("Mine blocks with several transactions each")
+        for _ in range(50):
+            for _ in range(5):
+                wallet.send_self_transfer(from_node=node)
+            wallet.generate(1)
+        height = node.getblockcount()
+
+        self.log.info("Build the txindex from scratch on several threads")
+        with node.assert_debug_log(["Syncing txindex with block chain from height", "on 4 threads", "txindex is enabled at height {}".format(height)]):
+            self.restart_node(0, extra_args=["-txindex", "-indexthreads=4"])
+            self.sync_index(height)
+        self.check_txindex()
+
+        self.log.info("Catch up with blocks mined while the index was disabled")
+        self.restart_node(0)
+        wallet.send_self_transfer(from_node=node)
+        wallet.generate(20)
+        height = node.getblockcount()
+        self.restart_node(0, extra_args=["-txindex", "-indexthreads=2"])
+        self.sync_index(height)
+        self.check_txindex()
+
+        self.log.info("Check that the index stays in sync with new blocks")
+        txid = wallet.send_self_transfer(from_node=node)['txid']
+        blockhash = wallet.generate(1)[0]
+        self.sync_index(height + 1)
+        assert_equal(node.getrawtransaction(txid, True)['blockhash'], blockhash)
+        height += 1
+
+        self.log.info("Build the block filter index on one thread, then again on several threads")
+        self.restart_node(0, extra_args=["-blockfilterindex"])
+        self.sync_index(height, 'basic block filter index')
+        expected_filters = self.get_block_filters()
+        self.stop_node(0)
+        shutil.rmtree(os.path.join(node.datadir, self.chain, 'indexes', 'blockfilter'))
+        with node.assert_debug_log(["Syncing basic block filter index with block chain from height", "on 3 threads"]):
+            self.start_node(0, extra_args=["-blockfilterindex", "-indexthreads=3"])
+            self.sync_index(height, 'basic block filter index')
+        # Filters and the header chain are the same
+        assert_equal(self.get_block_filters(), expected_filters)
+        # New blocks are chained to the headers written by the parallel sync
+        wallet.send_self_transfer(from_node=node)
+        wallet.generate(1)
+        self.sync_index(height + 1, 'basic block filter index')
+
+
+if __name__ == '__main__':
+    IndexParallelSyncTest().main()
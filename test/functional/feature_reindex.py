@@ -18,11 +18,13 @@ class ReindexTest(BitcoinDXTestFramework):
         self.setup_clean_chain = True
         self.num_nodes = 1
 
-    def reindex(self, justchainstate=False):
+    def reindex(self, justchainstate=False, importthreads=None):
         self.nodes[0].generatetoaddress(3, self.nodes[0].get_deterministic_priv_key().address)
         blockcount = self.nodes[0].getblockcount()
         self.stop_nodes()
         extra_args = [["-reindex-chainstate" if justchainstate else "-reindex"]]
+        if importthreads is not None:
+            extra_args[0].append("-importthreads={}".format(importthreads))
         self.start_nodes(extra_args)
         assert_equal(self.nodes[0].getblockcount(), blockcount)  # start_node is blocking on reindex
         self.log.info("Success")
@@ -32,6 +34,8 @@ class ReindexTest(BitcoinDXTestFramework):
         self.reindex(True)
         self.reindex(False)
         self.reindex(True)
+        self.reindex(False, importthreads=1)
+        self.reindex(False, importthreads=4)
 
 if __name__ == '__main__':
     ReindexTest().main()
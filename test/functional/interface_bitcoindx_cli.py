@@ -15,6 +15,7 @@ from test_framework.util import (
     assert_raises_rpc_error,
     get_auth_cookie,
 )
+import subprocess
 import time
 
 # The block reward of coinbaseoutput.nValue (50) BTC/block matures after
@@ -60,6 +61,28 @@ class TestBitcoinDXCli(BitcoinDXTestFramework):
         assert_equal(['foo', 'bar'], self.nodes[0].cli('-rpcuser={}'.format(user), '-stdin', '-stdinrpcpass', input=password + '\nfoo\nbar').echo())
         assert_raises_process_error(1, 'Incorrect rpcuser or rpcpassword', self.nodes[0].cli('-rpcuser={}'.format(user), '-stdin', '-stdinrpcpass', input='foo').echo)
 
+        self.log.info("Test -stdinpipeline")
+        genesis_hash = self.nodes[0].getblockhash(0)
+        genesis_header = self.nodes[0].getblockheader(genesis_hash, False)
+        commands = [
+            'getblockcount',
+            '',
+            'getblockhash 0',
+            'invalidmethod',
+            '  getblockheader "{}"  \'false\''.format(genesis_hash),
+            'getblockhash 1000000',
+            'getblockheader "{}'.format(genesis_hash),
+            'getblockhash 0',
+        ]
+        pipeline = subprocess.run(
+            [self.nodes[0].cli.binary, '-datadir=' + self.nodes[0].datadir, '-rpcuser={}'.format(user), '-stdinrpcpass', '-stdinpipeline'],
+            input='\n'.join([password] + commands) + '\n', stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+        assert_equal(pipeline.stdout.split('\n'), [str(BLOCKS), genesis_hash, genesis_header, genesis_hash, ''])
+        errors = pipeline.stderr
+        assert errors.index('Method not found') < errors.index('Block height out of range') < errors.index('unterminated quote')
+        assert_equal(pipeline.returncode, 1)
+        assert_raises_process_error(1, "cannot be combined with a command", self.nodes[0].cli('-stdinpipeline').getblockcount)
+
         self.log.info("Test connecting to a non-existing server")
         assert_raises_process_error(1, "Could not connect to the server", self.nodes[0].cli('-rpcport=1').echo)
 
@@ -22,7 +22,11 @@ from test_framework.util import (
     hex_str_to_bytes,
 )
 
-from test_framework.messages import BLOCK_HEADER_SIZE
+from test_framework.messages import (
+    BLOCK_HEADER_SIZE,
+    deser_compact_size,
+    ser_compact_size,
+)
 
 class ReqType(Enum):
     JSON = 1
@@ -205,6 +209,15 @@ class RESTTest (BitcoinDXTestFramework):
         long_uri = '/'.join(['{}-{}'.format(txid, n_) for n_ in range(15)])
         self.test_rest_request("/getutxos/checkmempool/{}".format(long_uri), http_method='POST', status=200)
 
+        # Larger batches can be sent as post data
+        def bin_utxo_request(count):
+            return b'\x01' + ser_compact_size(count) + (hex_str_to_bytes(txid)[::-1] + pack("<I", 0)) * count
+        bin_response = self.test_rest_request("/getutxos", http_method='POST', req_type=ReqType.BIN, body=bin_utxo_request(10000), ret_type=RetType.BYTES)
+        output = BytesIO(bin_response)
+        output.read(4 + 32)
+        assert_equal(deser_compact_size(output), (10000 + 7) // 8)
+        self.test_rest_request("/getutxos", http_method='POST', req_type=ReqType.BIN, body=bin_utxo_request(10001), status=400, ret_type=RetType.OBJ)
+
         self.nodes[0].generate(1)  # generate block to not affect upcoming tests
         self.sync_all()
 
@@ -222,6 +235,7 @@ class RESTTest (BitcoinDXTestFramework):
         self.nodes[0].reconsiderblock(bb_hash)
 
         # Check binary format
+        block_cache_hits = self.nodes[0].getnetworkinfo()['blockcache']['hits']
         response = self.test_rest_request("/block/{}".format(bb_hash), req_type=ReqType.BIN, ret_type=RetType.OBJ)
         assert_greater_than(int(response.getheader('content-length')), BLOCK_HEADER_SIZE)
         response_bytes = response.read()
@@ -237,6 +251,8 @@ class RESTTest (BitcoinDXTestFramework):
         assert_greater_than(int(response_hex.getheader('content-length')), BLOCK_HEADER_SIZE*2)
         response_hex_bytes = response_hex.read().strip(b'\n')
         assert_equal(binascii.hexlify(response_bytes), response_hex_bytes)
+        # The block was served from the serialized block cache the second time
+        assert_greater_than(self.nodes[0].getnetworkinfo()['blockcache']['hits'], block_cache_hits)
 
         # Compare with hex block header
         response_header_hex = self.test_rest_request("/headers/1/{}".format(bb_hash), req_type=ReqType.HEX, ret_type=RetType.OBJ)
@@ -281,6 +297,26 @@ class RESTTest (BitcoinDXTestFramework):
         json_obj = self.test_rest_request("/headers/5/{}".format(bb_hash))
         assert_equal(len(json_obj), 5)  # now we should have 5 header objects
 
+        self.log.info("Test the /blocks URI")
+        tip_height = self.nodes[0].getblockcount()
+        json_obj = self.test_rest_request("/blocks/1/{}".format(tip_height))
+        assert_equal([block['height'] for block in json_obj], list(range(1, tip_height + 1)))
+        assert_equal(json_obj[-1], self.test_rest_request("/block/{}".format(self.nodes[0].getbestblockhash())))
+
+        # The range ends at the tip
+        block_hexes = [self.nodes[0].getblock(self.nodes[0].getblockhash(h), 0) for h in range(tip_height - 2, tip_height + 1)]
+        response_bytes = self.test_rest_request("/blocks/{}/10".format(tip_height - 2), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(response_bytes.hex(), ''.join(block_hexes))
+        response_hex = self.test_rest_request("/blocks/{}/10".format(tip_height - 2), req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(response_hex.decode('utf-8').split(), block_hexes)
+
+        # Check invalid ranges
+        self.test_rest_request("/blocks/{}/1".format(tip_height + 1), status=404, ret_type=RetType.OBJ)
+        self.test_rest_request("/blocks/0/0", status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/blocks/0/10001", status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/blocks/-1/1", status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/blocks/0", status=400, ret_type=RetType.OBJ)
+
         self.log.info("Test tx inclusion in the /mempool and /block URIs")
 
         # Make 3 tx and mine them on node 1
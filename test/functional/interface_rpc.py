@@ -4,10 +4,21 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Tests some generic aspects of the RPC interface."""
 
+from decimal import Decimal
+import http.client
+import json
 import os
+import socket
+import struct
+import urllib.parse
+from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
 from test_framework.authproxy import JSONRPCException
+from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.messages import COIN, COutPoint, CTransaction, CTxIn, CTxInWitness, CTxOut
+from test_framework.script import CScript, OP_TRUE
 from test_framework.test_framework import BitcoinDXTestFramework
-from test_framework.util import assert_equal, assert_greater_than_or_equal
+from test_framework.util import assert_equal, assert_greater_than, assert_greater_than_or_equal, str_to_b64str
+from test_framework.wallet import MiniWallet
 from threading import Thread
 import subprocess
 
@@ -48,6 +59,18 @@ class RPCInterfaceTest(BitcoinDXTestFramework):
         assert_greater_than_or_equal(command['duration'], 0)
         assert_equal(info['logpath'], os.path.join(self.nodes[0].datadir, self.chain, 'debug.log'))
 
+        # Commands are counted once they have completed
+        assert 'getrpcinfo' not in info['methods']
+        info = self.nodes[0].getrpcinfo()
+        assert_equal(info['methods']['getrpcinfo']['calls'], 1)
+        assert_greater_than_or_equal(info['methods']['getrpcinfo']['max_duration'], 0)
+
+        workqueue = info['workqueue']
+        assert_equal(workqueue['maxdepth'], 16)
+        assert_equal(workqueue['rejected'], 0)
+        assert_equal(len(workqueue['workers']), 4)
+        assert_greater_than_or_equal(sum(worker['requests'] for worker in workqueue['workers']), 2)
+
     def test_batch_request(self):
         self.log.info("Testing basic JSON-RPC batch request...")
 
@@ -74,6 +97,121 @@ class RPCInterfaceTest(BitcoinDXTestFramework):
         assert_equal(result_by_id[3]['error'], None)
         assert result_by_id[3]['result'] is not None
 
+    def test_parallel_batch_request(self):
+        self.log.info("Testing parallel JSON-RPC batch request...")
+        self.restart_node(0, ['-rpcbatchthreads=4'])
+        node = self.nodes[0]
+
+        requests = [{"method": "getblockhash", "id": i, "params": [0]} for i in range(20)]
+        requests += [
+            {"method": "getblockcount", "id": 20},
+            # Not safe to run in parallel: executed after the requests before
+            # it and before the ones after it
+            {"method": "generatetoaddress", "id": 21, "params": [1, ADDRESS_BCRT1_UNSPENDABLE]},
+            {"method": "getblockcount", "id": 22},
+            {"method": "invalidmethod", "id": 23},
+        ]
+        requests += [{"method": "getblockhash", "id": 24 + i, "params": [i % 2]} for i in range(20)]
+        results = node.batch(requests)
+
+        assert_equal([res["id"] for res in results], list(range(len(requests))))
+        genesis_hash = node.getblockhash(0)
+        tip_hash = node.getbestblockhash()
+        for res in results[:20]:
+            assert_equal(res, {"result": genesis_hash, "error": None, "id": res["id"]})
+        assert_equal(results[20]["result"], 0)
+        assert_equal(results[21]["result"], [tip_hash])
+        assert_equal(results[22]["result"], 1)
+        assert_equal(results[23]["error"]["code"], -32601)
+        for i, res in enumerate(results[24:]):
+            assert_equal(res["result"], [genesis_hash, tip_hash][i % 2])
+
+    def test_binary_result(self):
+        self.log.info("Testing binary results...")
+        node = self.nodes[0]
+        url = urllib.parse.urlparse(node.url)
+        headers = {
+            "Authorization": "Basic " + str_to_b64str(url.username + ':' + url.password),
+            "Accept": "application/json;q=0.5, application/octet-stream",
+        }
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+
+        def call(method, params):
+            conn.request('POST', '/', json.dumps({"method": method, "params": params, "id": 1}), headers)
+            response = conn.getresponse()
+            return response.getheader('Content-Type'), response.read()
+
+        block_hash = node.getbestblockhash()
+        block_hex = node.getblock(block_hash, 0)
+        assert_equal(call("getblock", [block_hash, 0]), ("application/octet-stream", bytes.fromhex(block_hex)))
+        assert_equal(call("getblockheader", [block_hash, False]), ("application/octet-stream", bytes.fromhex(block_hex[:160])))
+        coinbase_txid = node.getblock(block_hash)["tx"][0]
+        tx_hex = node.getrawtransaction(coinbase_txid, False, block_hash)
+        assert_equal(call("getrawtransaction", [coinbase_txid, False, block_hash]), ("application/octet-stream", bytes.fromhex(tx_hex)))
+
+        # Other results and errors are sent as JSON
+        content_type, body = call("getblock", [block_hash, 1])
+        assert_equal(content_type, "application/json")
+        assert_equal(json.loads(body)["result"]["hash"], block_hash)
+        content_type, body = call("getblock", ["00" * 32, 0])
+        assert_equal(content_type, "application/json")
+        assert_equal(json.loads(body)["error"]["code"], -5)
+
+        # Without the Accept header, the hex string is returned
+        del headers["Accept"]
+        content_type, body = call("getblock", [block_hash, 0])
+        assert_equal(content_type, "application/json")
+        assert_equal(json.loads(body)["result"], block_hex)
+
+    def test_chunked_result(self):
+        self.log.info("Testing results streamed as chunked replies...")
+        node = self.nodes[0]
+        # Fill a block with transactions of many outputs, so that its verbose description is
+        # several MB
+        wallet = MiniWallet(node)
+        wallet.generate(10)
+        node.generatetoaddress(COINBASE_MATURITY, ADDRESS_BCRT1_UNSPENDABLE)
+        script_pubkey = bytes.fromhex(node.validateaddress(wallet.get_address())['scriptPubKey'])
+        for _ in range(10):
+            utxo = wallet.get_utxo()
+            tx = CTransaction()
+            tx.vin = [CTxIn(COutPoint(int(utxo['txid'], 16), utxo['vout']))]
+            tx.wit.vtxinwit = [CTxInWitness()]
+            tx.wit.vtxinwit[0].scriptWitness.stack = [CScript([OP_TRUE])]
+            tx.vout = [CTxOut(int(utxo['value'] * COIN) // 2001, script_pubkey) for _ in range(2000)]
+            node.sendrawtransaction(hexstring=tx.serialize().hex(), maxfeerate=0)
+        block_hash = node.generatetoaddress(1, ADDRESS_BCRT1_UNSPENDABLE)[0]
+
+        url = urllib.parse.urlparse(node.url)
+        headers = {"Authorization": "Basic " + str_to_b64str(url.username + ':' + url.password)}
+        request = json.dumps({"method": "getblock", "params": [block_hash, 2], "id": 1})
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('POST', '/', request, headers)
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert_equal(response.getheader('Transfer-Encoding'), 'chunked')
+        body = response.read()
+        assert_greater_than(len(body), 4 << 20)
+        streamed = json.loads(body, parse_float=Decimal)
+
+        # Batch entries are not streamed, and must describe the block the same way
+        conn.request('POST', '/', "[" + request + "]", headers)
+        response = conn.getresponse()
+        assert_equal(response.getheader('Transfer-Encoding'), None)
+        assert_equal(streamed, json.loads(response.read(), parse_float=Decimal)[0])
+        assert_equal(len(streamed['result']['tx']), 11)
+
+        # A client that leaves stops the handler, and the server keeps serving others
+        with node.assert_debug_log(["RPC client disconnected before the result was complete"], timeout=10):
+            sock = socket.create_connection((url.hostname, url.port))
+            sock.sendall("POST / HTTP/1.1\r\nHost: {}\r\nAuthorization: {}\r\nContent-Length: {}\r\n\r\n{}".format(
+                url.hostname, headers["Authorization"], len(request), request).encode())
+            assert sock.recv(1024).startswith(b"HTTP/1.1 200 OK")
+            # Reset the connection rather than leaving the reply to be read
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack('ii', 1, 0))
+            sock.close()
+        assert_equal(node.getbestblockhash(), block_hash)
+
     def test_http_status_codes(self):
         self.log.info("Testing HTTP status codes for JSON-RPC requests...")
 
@@ -92,10 +230,18 @@ class RPCInterfaceTest(BitcoinDXTestFramework):
         for t in threads:
             t.join()
 
+        workqueue = self.nodes[0].getrpcinfo()['workqueue']
+        assert_equal(workqueue['maxdepth'], 1)
+        assert_equal(len(workqueue['workers']), 1)
+        assert_greater_than_or_equal(workqueue['rejected'], 1)
+
     def run_test(self):
         self.test_getrpcinfo()
         self.test_batch_request()
+        self.test_parallel_batch_request()
+        self.test_binary_result()
         self.test_http_status_codes()
+        self.test_chunked_result()
         self.test_work_queue_exceeded()
 
 
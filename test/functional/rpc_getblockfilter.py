@@ -54,6 +54,39 @@ class GetBlockFilterTest(BitcoinDXTestFramework):
         genesis_hash = self.nodes[0].getblockhash(0)
         assert_raises_rpc_error(-5, "Unknown filtertype", self.nodes[0].getblockfilter, genesis_hash, "unknown")
 
+        # Test getblockfilter returns the same results with the filter cache enabled
+        expected = {block_hash: self.nodes[0].getblockfilter(block_hash) for block_hash in chain0_hashes + chain1_hashes}
+        assert 'blockfiltercache' not in self.nodes[1].getnetworkinfo()
+        self.restart_node(0, extra_args=["-blockfilterindex", "-blockfiltercachesize=1"])
+        cache = self.nodes[0].getnetworkinfo()['blockfiltercache']
+        # The filters and the header chain each get half of the cache size
+        assert_equal(cache['filters']['maxbytes'], 1 << 19)
+        assert 0 < cache['headers']['maxbytes'] <= 1 << 19
+        assert_equal(cache['headers']['entries'], 5)
+        assert 0 < cache['headers']['bytes'] < cache['headers']['maxbytes']
+        for _ in range(2):
+            for block_hash, result in expected.items():
+                assert_equal(self.nodes[0].getblockfilter(block_hash), result)
+        cache = self.nodes[0].getnetworkinfo()['blockfiltercache']
+        # Every filter is read from disk once, the second round is served from the cache
+        assert_equal(cache['filters']['entries'], len(expected))
+        assert_equal(cache['filters']['misses'], len(expected))
+        assert_equal(cache['filters']['hits'], len(expected))
+        # Blocks of the stale chain are not in the header chain
+        assert cache['headers']['hits'] > 0
+        assert cache['headers']['misses'] > 0
+
+        # Test the header chain follows reorgs and new blocks
+        self.nodes[0].invalidateblock(chain1_hashes[1])
+        assert_equal(self.nodes[0].getbestblockhash(), chain0_hashes[3])
+        self.nodes[0].generate(3)
+        self.wait_until(lambda: self.nodes[0].getindexinfo("basic block filter index")["basic block filter index"]["best_block_height"] == 6)
+        assert_equal(self.nodes[0].getnetworkinfo()['blockfiltercache']['headers']['entries'], 7)
+        hits = self.nodes[0].getnetworkinfo()['blockfiltercache']['headers']['hits']
+        for block_hash in chain0_hashes:
+            assert_equal(self.nodes[0].getblockfilter(block_hash), expected[block_hash])
+        assert self.nodes[0].getnetworkinfo()['blockfiltercache']['headers']['hits'] > hits
+
         # Test getblockfilter fails on node without compact block filter index
         self.restart_node(0, extra_args=["-blockfilterindex=0"])
         for filter_type in FILTER_TYPES:
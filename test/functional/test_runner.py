@@ -303,6 +303,7 @@ BASE_SCRIPTS = [
     'rpc_help.py',
     'feature_help.py',
     'feature_shutdown.py',
+    'feature_index_parallel_sync.py',
     'p2p_ibd_txrelay.py',
     'feature_blockfilterindex_prune.py'
     # Don't append tests at the end to avoid merge conflicts